@@ -0,0 +1,164 @@
+#include "ar_archive.h"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace lyn {
+
+namespace {
+
+constexpr std::string_view MAGIC = "!<arch>\n";
+constexpr std::string_view THIN_MAGIC = "!<thin>\n";
+
+constexpr unsigned HEADER_SIZE = 60;
+
+std::uint32_t load_be32(const std::uint8_t* data) {
+	return (std::uint32_t(data[0]) << 24) | (std::uint32_t(data[1]) << 16) | (std::uint32_t(data[2]) << 8) | data[3];
+}
+
+} // namespace
+
+ar_archive::ar_archive(std::string_view fileName, std::span<const std::uint8_t> data)
+	: mFileName(fileName), mData(data) {
+	std::string_view text(reinterpret_cast<const char*>(data.data()), data.size());
+
+	if (text.starts_with(THIN_MAGIC))
+		fail("thin archives aren't supported");
+
+	if (!text.starts_with(MAGIC))
+		fail("not an archive");
+
+	// the symbol index and long name table come before any regular member
+
+	bool hasIndex = false;
+
+	for (unsigned offset = MAGIC.size(); offset < data.size(); ) {
+		header head = header_at(offset);
+
+		if (head.name == "/") {
+			const std::uint8_t* index = data.data() + head.offset;
+
+			if (head.size < 4)
+				fail("bad symbol index");
+
+			std::uint32_t count = load_be32(index);
+
+			if (count > (head.size - 4) / 4)
+				fail("bad symbol index");
+
+			const char* names = reinterpret_cast<const char*>(index + 4 + count * 4);
+			const char* namesEnd = reinterpret_cast<const char*>(index + head.size);
+
+			mSymbols.reserve(count);
+
+			for (unsigned i = 0; i < count; ++i) {
+				const void* end = std::memchr(names, 0, namesEnd - names);
+
+				if (!end)
+					fail("bad symbol index");
+
+				mSymbols.push_back({ std::string_view(names, static_cast<const char*>(end) - names), load_be32(index + 4 + i * 4) });
+				names = static_cast<const char*>(end) + 1;
+			}
+
+			hasIndex = true;
+		} else if (head.name == "//") {
+			mLongNames = std::string_view(reinterpret_cast<const char*>(data.data() + head.offset), head.size);
+		} else {
+			break;
+		}
+
+		offset = head.offset + head.size + (head.size & 1);
+	}
+
+	if (!hasIndex)
+		fail("archive has no symbol index (run ranlib on it)");
+}
+
+bool ar_archive::is_archive_file(const std::string& fileName) {
+	std::ifstream input(fileName, std::ios::in | std::ios::binary);
+
+	char magic[MAGIC.size()] {};
+	input.read(magic, sizeof(magic));
+
+	std::string_view read(magic, input.gcount());
+
+	return read == MAGIC || read == THIN_MAGIC;
+}
+
+ar_archive::member ar_archive::member_at(unsigned offset) const {
+	header head = header_at(offset);
+
+	member result;
+	result.data = mData.subspan(head.offset, head.size);
+
+	// GNU names end with a slash, long names are "/<offset in long name table>"
+
+	if (head.name.size() > 1 && head.name[0] == '/') {
+		unsigned long nameOffset = 0;
+
+		for (char c : head.name.substr(1)) {
+			if (c < '0' || c > '9')
+				fail(std::format("bad name for member at {0}", offset));
+
+			nameOffset = nameOffset * 10 + (c - '0');
+		}
+
+		if (nameOffset >= mLongNames.size())
+			fail(std::format("bad name for member at {0}", offset));
+
+		std::string_view name = mLongNames.substr(nameOffset);
+		result.name = name.substr(0, name.find('\n'));
+	} else {
+		result.name = head.name;
+	}
+
+	if (!result.name.empty() && result.name.back() == '/')
+		result.name.pop_back();
+
+	return result;
+}
+
+ar_archive::header ar_archive::header_at(unsigned offset) const {
+	if (offset > mData.size() || mData.size() - offset < HEADER_SIZE)
+		fail(std::format("member at {0} is out of the file", offset));
+
+	const char* raw = reinterpret_cast<const char*>(mData.data() + offset);
+
+	if (raw[58] != '`' || raw[59] != '\n')
+		fail(std::format("bad header for member at {0}", offset));
+
+	header result;
+
+	result.name = std::string_view(raw, 16);
+	result.name = result.name.substr(0, result.name.find_last_not_of(' ') + 1);
+
+	std::uint64_t size = 0;
+
+	for (char c : std::string_view(raw + 48, 10)) {
+		if (c == ' ')
+			break;
+
+		if (c < '0' || c > '9')
+			fail(std::format("bad header for member at {0}", offset));
+
+		size = size * 10 + (c - '0');
+	}
+
+	result.offset = offset + HEADER_SIZE;
+
+	if (size > mData.size() - result.offset)
+		fail(std::format("member at {0} is out of the file", offset));
+
+	result.size = size;
+
+	return result;
+}
+
+void ar_archive::fail(std::string_view what) const {
+	throw std::runtime_error(std::format("{0}: {1}", mFileName, what));
+}
+
+} // namespace lyn
@@ -0,0 +1,64 @@
+#ifndef AR_ARCHIVE_H
+#define AR_ARCHIVE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief index of a static (`ar`) archive, as made by GNU ar
+ *
+ * Only the symbol index (the "/" member) and the long name table ("//") are
+ * read up front. Members are only looked at when asked for, so that the
+ * ones that aren't needed don't cost anything. Views point into the archive
+ * data, which has to outlive the index.
+ *
+ */
+class ar_archive {
+public:
+	struct symbol {
+		std::string_view name;
+		unsigned memberOffset; // offset of the header of the member defining it
+	};
+
+	struct member {
+		std::string name;
+		std::span<const std::uint8_t> data;
+	};
+
+public:
+	ar_archive(std::string_view fileName, std::span<const std::uint8_t> data);
+
+	/* whether the file starts like an archive (this only reads the magic) */
+	static bool is_archive_file(const std::string& fileName);
+
+	const std::vector<symbol>& symbols() const { return mSymbols; }
+
+	/* member whose header is at the given offset, as found in the symbol index */
+	member member_at(unsigned offset) const;
+
+private:
+	struct header {
+		std::string_view name;
+		unsigned offset; // offset of the data
+		unsigned size;
+	};
+
+	header header_at(unsigned offset) const;
+
+	[[noreturn]] void fail(std::string_view what) const;
+
+	std::string_view mFileName;
+	std::span<const std::uint8_t> mData;
+
+	std::string_view mLongNames;
+	std::vector<symbol> mSymbols;
+};
+
+} // namespace lyn
+
+#endif // AR_ARCHIVE_H
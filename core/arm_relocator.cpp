@@ -1,202 +1,169 @@
 #include "arm_relocator.h"
 
+#include <array>
 #include <format>
+#include <iterator>
 
 #include "elfcpp/elfcpp.h"
 #include "elfcpp/arm.h"
 
 namespace lyn {
 
-struct arm_data_abs32_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data& data, unsigned int offset, const std::string& sym, int addend) const {
-		return lyn::event_code(
-			lyn::event_code::CODE_POIN,
-			arm_relocator::abs_reloc_string(sym, data.read<std::uint32_t>(offset) + addend));
-	}
+namespace {
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		data.write<std::uint32_t>(offset, (data.read<std::uint32_t>(offset) + value + addend));
-	}
-};
+using descriptor = arm_relocator::descriptor;
 
-struct arm_data_rel32_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data& data, unsigned int offset, const std::string &sym, int addend) const {
-		return lyn::event_code(
-			lyn::event_code::CODE_WORD,
-			arm_relocator::rel_reloc_string(sym, data.read<std::uint32_t>(offset) + addend));
-	}
+constexpr descriptor data_reloc(event_code::code_type_enum code, unsigned size, bool isPcRelative) {
+	std::uint32_t mask = (size == 4) ? 0xFFFFFFFF : ((1u << (size * 8)) - 1);
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		data.write<std::uint32_t>(offset, (data.read<std::uint32_t>(offset) + value + addend - offset));
-	}
-};
+	return { code, size, 1, { { 0, mask, 0, 0 }, {} }, 0, isPcRelative, true, !isPcRelative, arm_relocator::NoTrampoline };
+}
 
-struct arm_data_abs16_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data& data, unsigned int offset, const std::string& sym, int addend) const {
-		return lyn::event_code(
-			lyn::event_code::CODE_SHORT,
-			arm_relocator::abs_reloc_string(sym, data.read<std::uint16_t>(offset) + addend));
-	}
+constexpr descriptor branch_reloc(event_code::code_type_enum code, unsigned size, int pcBias,
+	arm_relocator::field first, arm_relocator::trampoline_kind trampoline)
+{
+	return { code, size, 1, { first, {} }, pcBias, true, false, false, trampoline };
+}
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		data.write<std::uint16_t>(offset, (data.read<std::uint16_t>(offset) + value + addend));
-	}
-};
+constexpr descriptor thumb_bl_reloc() {
+	return {
+		event_code::CODE_SHORT, 2, 2,
+		{ { 12, 0x7FF, 0xF000, 0 }, { 1, 0x7FF, 0xF800, 0 } },
+		4, true, false, false, arm_relocator::ThumbTrampoline
+	};
+}
 
-struct arm_data_abs8_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data& data, unsigned int offset, const std::string& sym, int addend) const {
-		return lyn::event_code(
-			lyn::event_code::CODE_BYTE,
-			arm_relocator::abs_reloc_string(sym, data.read_byte(offset) + addend));
-	}
+// indexed by relocation type, entries with no units are unsupported relocation types
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		data.write_byte(offset, (data.read_byte(offset) + value + addend));
-	}
-};
+constexpr auto DESCRIPTORS = [] {
+	std::array<descriptor, 256> table {};
 
-struct arm_thumb_b_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data&, unsigned int, const std::string& sym, int addend) const {
-		std::string value = arm_relocator::pcrel_reloc_string(sym, addend);
+	table[elfcpp::R_ARM_ABS32]      = data_reloc(event_code::CODE_POIN, 4, false);
+	table[elfcpp::R_ARM_REL32]      = data_reloc(event_code::CODE_WORD, 4, true);
+	table[elfcpp::R_ARM_ABS16]      = data_reloc(event_code::CODE_SHORT, 2, false);
+	table[elfcpp::R_ARM_ABS8]       = data_reloc(event_code::CODE_BYTE, 1, false);
+	table[elfcpp::R_ARM_THM_CALL]   = thumb_bl_reloc();
+	table[elfcpp::R_ARM_CALL]       = branch_reloc(event_code::CODE_WORD, 4, 8, { 2, 0xFFFFFF, 0, 0xFF000000 }, arm_relocator::ArmTrampoline);
+	table[elfcpp::R_ARM_JUMP24]     = branch_reloc(event_code::CODE_WORD, 4, 8, { 2, 0xFFFFFF, 0, 0xFF000000 }, arm_relocator::NoTrampoline);
+	table[elfcpp::R_ARM_THM_JUMP11] = branch_reloc(event_code::CODE_SHORT, 2, 4, { 1, 0x7FF, 0xE000, 0 }, arm_relocator::ThumbTrampoline);
+	table[elfcpp::R_ARM_THM_JUMP8]  = branch_reloc(event_code::CODE_SHORT, 2, 4, { 1, 0xFF, 0, 0xFF00 }, arm_relocator::ThumbTrampoline);
 
-		return lyn::event_code(lyn::event_code::CODE_SHORT, {
-			arm_relocator::b_string(value)
-		});
-	}
+	return table;
+}();
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		std::uint32_t relocatedValue = (value + addend - offset - 4);
+std::uint32_t load_unit(const std::uint8_t* data, unsigned size) {
+	switch (size) {
 
-		data.write<std::uint16_t>(offset, (((relocatedValue>>1) & 0x7FF) | 0xE000));
-	}
+	case 1:
+		return *data;
 
-	bool is_absolute() const {
-		return false;
-	}
+	case 2:
+		return load_le<std::uint16_t>(data);
 
-	bool can_make_trampoline() const {
-		return true;
-	}
+	default:
+		return load_le<std::uint32_t>(data);
 
-	section_data make_trampoline(const std::string& symbol, int addend) const {
-		return arm_relocator::make_thumb_veneer(symbol, addend);
 	}
-};
+}
 
-struct arm_thumb_bcond_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data& data, unsigned int offset, const std::string& sym, int addend) const {
-		std::string value  = arm_relocator::pcrel_reloc_string(sym, addend);
+void store_unit(std::uint8_t* data, unsigned size, std::uint32_t value) {
+	switch (size) {
 
-		return lyn::event_code(lyn::event_code::CODE_SHORT, {
-			arm_relocator::bcond_string((data.read<std::uint16_t>(offset) & 0xFF00), value)
-		});
-	}
+	case 1:
+		*data = value;
+		break;
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		std::uint32_t relocatedValue = (value + addend - offset - 4);
+	case 2:
+		store_le<std::uint16_t>(data, value);
+		break;
 
-		data.write<std::uint16_t>(offset, (((relocatedValue>>1) & 0xFF) | (data.read<std::uint16_t>(offset) & 0xFF00)));
-	}
+	default:
+		store_le<std::uint32_t>(data, value);
+		break;
 
-	bool is_absolute() const {
-		return false;
 	}
+}
 
-	bool can_make_trampoline() const {
-		return true;
-	}
+} // namespace
 
-	section_data make_trampoline(const std::string& symbol, int addend) const {
-		return arm_relocator::make_thumb_veneer(symbol, addend);
-	}
-};
+const arm_relocator::descriptor* arm_relocator::get_descriptor(unsigned relocationType) {
+	if (relocationType >= DESCRIPTORS.size() || DESCRIPTORS[relocationType].unitCount == 0)
+		return nullptr;
 
-struct arm_thumb_bl_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data&, unsigned int, const std::string& sym, int addend) const {
-		std::string value = arm_relocator::pcrel_reloc_string(sym, addend);
+	return &DESCRIPTORS[relocationType];
+}
 
-		return lyn::event_code(lyn::event_code::CODE_SHORT, {
-			arm_relocator::bl_op1_string(value),
-			arm_relocator::bl_op2_string(value)
-		});
-	}
+event_code arm_relocator::descriptor::make_event_code(const section_data& data, unsigned int offset, std::string_view sym, int addend, std::pmr::memory_resource* resource) const {
+	auto bytes = data.bytes(offset, unitSize * unitCount);
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		std::uint32_t relocatedValue = (value + addend - offset - 4);
+	if (hasInPlaceAddend)
+		addend += load_unit(bytes.data(), unitSize);
 
-		data.write<std::uint16_t>(offset + 0, (((relocatedValue>>12) & 0x7FF) | 0xF000));
-		data.write<std::uint16_t>(offset + 2, (((relocatedValue>>1)  & 0x7FF) | 0xF800));
-	}
+	std::pmr::string value = isPcRelative
+		? rel_reloc_string(sym, addend - pcBias, resource)
+		: abs_reloc_string(sym, addend, resource);
 
-	bool is_absolute() const {
-		return false;
-	}
+	std::pmr::vector<std::pmr::string> arguments(resource);
+	arguments.reserve(unitCount);
 
-	bool can_make_trampoline() const {
-		return true;
-	}
+	std::uint32_t unitMask = (unitSize == 4) ? 0xFFFFFFFF : ((1u << (unitSize * 8)) - 1);
 
-	section_data make_trampoline(const std::string& symbol, int addend) const {
-		return arm_relocator::make_thumb_veneer(symbol, addend);
-	}
-};
+	for (unsigned i = 0; i < unitCount; ++i) {
+		const field& field = fields[i];
 
-struct arm_arm_b_reloc : public arm_relocator::relocatelet {
-	event_code make_event_code(const section_data& data, unsigned int offset, const std::string &sym, int addend) const {
-		std::string value = arm_relocator::pcrel_arm_reloc_string(sym, addend);
+		if (field.shift == 0 && field.mask == unitMask && field.fixedBits == 0 && field.keptBits == 0) {
+			arguments.push_back(value);
+			continue;
+		}
 
-		return lyn::event_code(
-			lyn::event_code::CODE_WORD,
-			arm_relocator::b24_arm_string(data.read<uint32_t>(offset), value));
+		std::uint32_t base = field.fixedBits | (load_unit(bytes.data() + i * unitSize, unitSize) & field.keptBits);
+		auto& argument = arguments.emplace_back();
+		std::format_to(std::back_inserter(argument), "(({0}>>{1})&${2:X})|${3:X}", value, field.shift, field.mask, base);
 	}
 
-	void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
-		std::uint32_t relocatedValue = (value + addend - offset - 8);
+	return event_code(code, std::move(arguments));
+}
+
+void arm_relocator::descriptor::apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const {
+	auto bytes = data.bytes(offset, unitSize * unitCount);
 
-		data.write<std::uint32_t>(offset, (((relocatedValue>>2) & 0xFFFFFF) | (data.read<uint32_t>(offset) & 0xFF000000)));
-	}
+	std::uint32_t relocatedValue = value + addend;
 
-	bool is_absolute() const {
-		return false;
-	}
-};
+	if (hasInPlaceAddend)
+		relocatedValue += load_unit(bytes.data(), unitSize);
 
-struct arm_arm_bl_reloc : public arm_arm_b_reloc {
-	bool can_make_trampoline() const {
-		return true;
-	}
+	if (isPcRelative)
+		relocatedValue -= offset + pcBias;
 
-	section_data make_trampoline(const std::string& symbol, int addend) const {
-		return arm_relocator::make_arm_veneer(symbol, addend);
+	for (unsigned i = 0; i < unitCount; ++i) {
+		const field& field = fields[i];
+		std::uint8_t* unit = bytes.data() + i * unitSize;
+
+		store_unit(unit, unitSize,
+			((relocatedValue >> field.shift) & field.mask) | field.fixedBits | (load_unit(unit, unitSize) & field.keptBits));
 	}
-};
-
-arm_relocator::arm_relocator() {
-	mRelocatelets[elfcpp::R_ARM_ABS32].reset(new arm_data_abs32_reloc);  // R_ARM_ABS32
-	mRelocatelets[elfcpp::R_ARM_REL32].reset(new arm_data_rel32_reloc);  // R_ARM_REL32
-	mRelocatelets[elfcpp::R_ARM_ABS16].reset(new arm_data_abs16_reloc);  // R_ARM_ABS16
-	mRelocatelets[elfcpp::R_ARM_ABS8].reset(new arm_data_abs8_reloc);   // R_ARM_ABS8
-	mRelocatelets[elfcpp::R_ARM_THM_CALL].reset(new arm_thumb_bl_reloc);    // R_ARM_THM_CALL
-	mRelocatelets[elfcpp::R_ARM_CALL].reset(new arm_arm_bl_reloc);      // R_ARM_CALL
-	mRelocatelets[elfcpp::R_ARM_JUMP24].reset(new arm_arm_b_reloc);       // R_ARM_JUMP24
-	mRelocatelets[elfcpp::R_ARM_THM_JUMP11].reset(new arm_thumb_b_reloc);     // R_ARM_THM_JUMP11
-	mRelocatelets[elfcpp::R_ARM_THM_JUMP8].reset(new arm_thumb_bcond_reloc); // R_ARM_THM_JUMP8
 }
 
-const arm_relocator::relocatelet* arm_relocator::get_relocatelet(int relocationIndex) const {
-	auto it = mRelocatelets.find(relocationIndex);
+section_data arm_relocator::descriptor::make_trampoline(symbol_ref symbol, int addend) const {
+	switch (trampoline) {
 
-	if (it == mRelocatelets.end())
-		return nullptr;
+	case ThumbTrampoline:
+		return make_thumb_veneer(symbol, addend);
+
+	case ArmTrampoline:
+		return make_arm_veneer(symbol, addend);
+
+	default:
+		return section_data();
 
-	return it->second.get();
+	}
 }
 
-std::string arm_relocator::abs_reloc_string(const std::string& symbol, int addend) {
+std::pmr::string arm_relocator::abs_reloc_string(std::string_view symbol, int addend, std::pmr::memory_resource* resource) {
 	if (addend == 0)
-		return symbol;
+		return std::pmr::string(symbol, resource);
 
-	std::string result;
+	std::pmr::string result(resource);
 	result.reserve(3 + 8 + symbol.size()); // 5 ("(-)") + 8 (addend literal int) + symbol string
 
 	result.append(symbol);
@@ -209,11 +176,11 @@ std::string arm_relocator::abs_reloc_string(const std::string& symbol, int adden
 	return result;
 }
 
-std::string arm_relocator::rel_reloc_string(const std::string& symbol, int addend) {
+std::pmr::string arm_relocator::rel_reloc_string(std::string_view symbol, int addend, std::pmr::memory_resource* resource) {
 	if (addend == 0)
-		return symbol;
+		return std::pmr::string(symbol, resource);
 
-	std::string result;
+	std::pmr::string result(resource);
 	result.reserve(17 + 8 + symbol.size()); // 17 ("(--CURRENTOFFSET)") + 8 (addend literal int) + symbol string
 
 	result.append(symbol);
@@ -227,50 +194,7 @@ std::string arm_relocator::rel_reloc_string(const std::string& symbol, int adden
 	return result;
 }
 
-std::string arm_relocator::pcrel_reloc_string(const std::string& symbol, int addend) {
-	return rel_reloc_string(symbol, addend-4);
-}
-
-std::string arm_relocator::pcrel_arm_reloc_string(const std::string& symbol, int addend) {
-	return rel_reloc_string(symbol, addend-8);
-}
-
-std::string arm_relocator::b24_arm_string(std::uint32_t base, const std::string& valueString) {
-	base &= 0xFF000000;
-	return std::format("(({0}>>2)&$FFFFFF)|${1:X}", valueString, base);
-}
-
-std::string arm_relocator::b_string(const std::string& valueString) {
-	return std::format("(({0}>>1)&$7FF)|$E000", valueString);
-}
-
-std::string arm_relocator::bcond_string(std::uint16_t base, const std::string& valueString) {
-	return std::format("(({0}>>1)&$FF)|${1:X}", valueString, base);
-}
-
-std::string arm_relocator::bl_op1_string(const std::string& valueString) {
-	std::string result;
-	result.reserve(20 + valueString.size());
-
-	result.append("((");
-	result.append(valueString);
-	result.append(">>12)&$7FF)|$F000");
-
-	return result;
-}
-
-std::string arm_relocator::bl_op2_string(const std::string& valueString) {
-	std::string result;
-	result.reserve(19 + valueString.size());
-
-	result.append("((");
-	result.append(valueString);
-	result.append(">>1)&$7FF)|$F800");
-
-	return result;
-}
-
-section_data arm_relocator::make_thumb_veneer(const std::string& symbol, int addend) {
+section_data arm_relocator::make_thumb_veneer(symbol_ref symbol, int addend) {
 	section_data result;
 
 	result.resize(0x10);
@@ -285,12 +209,12 @@ section_data arm_relocator::make_thumb_veneer(const std::string& symbol, int add
 	result.set_mapping(0x04, section_data::mapping::ARM);
 	result.set_mapping(0x0C, section_data::mapping::Data);
 
-	result.relocations().push_back({ symbol, addend, 0x02, 0x0C });
+	result.add_relocation(symbol, addend, 0x02, 0x0C);
 
 	return result;
 }
 
-section_data arm_relocator::make_arm_veneer(const std::string& symbol, int addend) {
+section_data arm_relocator::make_arm_veneer(symbol_ref symbol, int addend) {
 	section_data result;
 
 	result.resize(0x0C);
@@ -302,7 +226,7 @@ section_data arm_relocator::make_arm_veneer(const std::string& symbol, int adden
 	result.set_mapping(0x00, section_data::mapping::ARM);
 	result.set_mapping(0x08, section_data::mapping::Data);
 
-	result.relocations().push_back({ symbol, addend, 0x02, 0x08 });
+	result.add_relocation(symbol, addend, 0x02, 0x08);
 
 	return result;
 }
@@ -5,49 +5,83 @@
 
 #include "../ea/event_code.h"
 
-#include <memory>
-#include <map>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
 
 namespace lyn {
 
 class arm_relocator {
 public:
-	struct relocatelet {
-		virtual ~relocatelet() {}
+	enum trampoline_kind {
+		NoTrampoline,
+		ThumbTrampoline,
+		ArmTrampoline,
+	};
+
+	/* a bit-field of the relocated data
+	 * written as ((value >> shift) & mask) | fixedBits | (original & keptBits) */
 
-		virtual event_code make_event_code(const section_data& data, unsigned int offset, const std::string& sym, int addend) const = 0;
-		virtual void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const = 0;
+	struct field {
+		unsigned shift;
 
-		virtual bool is_absolute() const { return true; }
-		virtual bool can_make_trampoline() const { return false; }
-		virtual section_data make_trampoline(const std::string& symbol, int addend) const { return section_data(); }
+		std::uint32_t mask;
+		std::uint32_t fixedBits;
+		std::uint32_t keptBits;
 	};
 
-public:
-	arm_relocator();
+	/*!
+	 * \brief describes how to apply (or output) one type of relocation
+	 *
+	 * The relocated value is S + A, minus P + pcBias when the relocation is pc
+	 * relative. When hasInPlaceAddend, the original data is added to A (this is
+	 * for REL-style data relocations, branches ignore their original offset).
+	 *
+	 * The relocated value is then split into unitCount consecutive units of
+	 * unitSize bytes, each described by its field.
+	 *
+	 */
 
-	const relocatelet* get_relocatelet(int relocationIndex) const;
+	struct descriptor {
+		event_code::code_type_enum code;
 
-public:
-	static std::string abs_reloc_string(const std::string& symbol, int addend);
-	static std::string rel_reloc_string(const std::string& symbol, int addend);
+		unsigned unitSize;
+		unsigned unitCount;
+
+		field fields[2];
+
+		int pcBias;
 
-	static std::string pcrel_reloc_string(const std::string& symbol, int addend);
-	static std::string pcrel_arm_reloc_string(const std::string& symbol, int addend);
+		bool isPcRelative;
+		bool hasInPlaceAddend;
+		bool isAbsolute;
 
-	static std::string b24_arm_string(uint32_t base, const std::string& valueString);
+		trampoline_kind trampoline;
 
-	static std::string b_string(const std::string& valueString);
-	static std::string bcond_string(uint16_t base, const std::string& valueString);
+		/* the event code (and its arguments) are allocated from resource */
+		event_code make_event_code(const section_data& data, unsigned int offset, std::string_view sym, int addend,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+		void apply_relocation(section_data& data, unsigned int offset, unsigned int value, int addend) const;
 
-	static std::string bl_op1_string(const std::string& valueString);
-	static std::string bl_op2_string(const std::string& valueString);
+		/* absolute relocations can be resolved knowing only the value of the symbol */
+		bool is_absolute() const { return isAbsolute; }
 
-	static section_data make_thumb_veneer(const std::string& symbol, int addend);
-	static section_data make_arm_veneer(const std::string& symbol, int addend);
+		bool can_make_trampoline() const { return trampoline != NoTrampoline; }
+		section_data make_trampoline(symbol_ref symbol, int addend) const;
+	};
+
+public:
+	static const descriptor* get_descriptor(unsigned relocationType);
+
+public:
+	static std::pmr::string abs_reloc_string(std::string_view symbol, int addend,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	static std::pmr::string rel_reloc_string(std::string_view symbol, int addend,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-private:
-	std::map<int, std::unique_ptr<relocatelet>> mRelocatelets;
+	static section_data make_thumb_veneer(symbol_ref symbol, int addend);
+	static section_data make_arm_veneer(symbol_ref symbol, int addend);
 };
 
 } // namespace lyn
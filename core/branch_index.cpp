@@ -0,0 +1,106 @@
+#include "branch_index.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "data_chunk.h"
+
+namespace lyn {
+
+void branch_index::build(std::span<const std::uint8_t> rom, std::vector<code_range> code, std::vector<rom_range> excluded) {
+	mBranches.clear();
+
+	// excluded ranges are merged, so that whether a branch is in one is told by the one starting before it
+
+	std::sort(excluded.begin(), excluded.end());
+
+	std::vector<rom_range> merged;
+
+	for (auto& range : excluded) {
+		if (!merged.empty() && range.first <= merged.back().second)
+			merged.back().second = std::max(merged.back().second, range.second);
+		else
+			merged.push_back(range);
+	}
+
+	auto isExcluded = [&merged] (unsigned offset) -> bool {
+		auto it = std::upper_bound(merged.begin(), merged.end(), rom_range { offset + 3, ~0u });
+		return it != merged.begin() && std::prev(it)->second > offset;
+	};
+
+	// functions can overlap (as with aliases), the parts already scanned aren't scanned again
+
+	std::sort(code.begin(), code.end(), [] (const code_range& a, const code_range& b) {
+		return a.begin < b.begin;
+	});
+
+	std::size_t scannedEnd = 0;
+
+	for (auto& range : code) {
+		const std::size_t begin = std::max<std::size_t>(range.begin, scannedEnd);
+		const std::size_t end = std::min<std::size_t>(range.end, rom.size());
+
+		if (begin >= end)
+			continue;
+
+		scannedEnd = end;
+
+		if (range.isThumb) {
+			// thumb BL is encoded as two halfwords: 11110 hi11 11111 lo11
+
+			for (std::size_t offset = (begin + 1) & ~std::size_t(1); offset + 4 <= end; offset += 2) {
+				const auto first = load_le<std::uint16_t>(rom.data() + offset);
+				const auto second = load_le<std::uint16_t>(rom.data() + offset + 2);
+
+				if ((first & 0xF800) != 0xF000 || (second & 0xF800) != 0xF800 || isExcluded(offset))
+					continue;
+
+				std::int32_t displacement = ((first & 0x7FF) << 21) >> 9; // sign extended, shifted by 12
+				displacement |= (second & 0x7FF) << 1;
+
+				mBranches.push_back({ unsigned(offset + 4 + displacement), unsigned(offset), ThumbBL });
+			}
+		} else {
+			// ARM B/BL is cccc 101L imm24, with cccc = 1111 being BLX (which we don't want)
+
+			for (std::size_t offset = (begin + 3) & ~std::size_t(3); offset + 4 <= end; offset += 4) {
+				const auto word = load_le<std::uint32_t>(rom.data() + offset);
+
+				if ((word & 0x0E000000) != 0x0A000000 || (word >> 28) == 0xF || isExcluded(offset))
+					continue;
+
+				std::int32_t displacement = static_cast<std::int32_t>(word << 8) >> 6;
+
+				mBranches.push_back({ unsigned(offset + 8 + displacement), unsigned(offset), (word & 0x01000000) ? ArmBL : ArmB });
+			}
+		}
+	}
+
+	std::sort(mBranches.begin(), mBranches.end(),
+		[] (const branch& a, const branch& b) -> bool {
+			return (a.target != b.target) ? (a.target < b.target) : (a.offset < b.offset);
+		}
+	);
+}
+
+std::span<const branch_index::branch> branch_index::branches_to(unsigned target) const {
+	auto range = std::equal_range(mBranches.begin(), mBranches.end(), branch { target, 0, ThumbBL },
+		[] (const branch& a, const branch& b) -> bool {
+			return a.target < b.target;
+		}
+	);
+
+	return { range.first, range.second };
+}
+
+bool branch_index::can_reach(branch_kind kind, unsigned offset, unsigned target) {
+	if (kind == ThumbBL) {
+		std::int64_t displacement = std::int64_t(target) - (std::int64_t(offset) + 4);
+		return displacement >= -0x400000 && displacement <= 0x3FFFFE;
+	}
+
+	std::int64_t displacement = std::int64_t(target) - (std::int64_t(offset) + 8);
+	return displacement >= -0x2000000 && displacement <= 0x1FFFFFC && (displacement % 4) == 0;
+}
+
+} // namespace lyn
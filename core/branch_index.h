@@ -0,0 +1,62 @@
+#ifndef BRANCH_INDEX_H
+#define BRANCH_INDEX_H
+
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief index of the direct branches found in a ROM, by branch target
+ *
+ * Indexes the thumb BL pairs (at any halfword) and ARM B/BL (at any word)
+ * found in known code, by decoded target. Code is known from the functions
+ * of the reference symbols (those with a size): thumb BLs are only looked
+ * for in thumb functions, and ARM branches in ARM ones, so that data (or code
+ * of the other instruction set) that happens to decode as a branch isn't
+ * taken for one. Branches in excluded ranges (such as bytes lyn writes over)
+ * are left out as well.
+ *
+ */
+class branch_index {
+public:
+	enum branch_kind {
+		ThumbBL,
+		ArmB,
+		ArmBL,
+	};
+
+	struct branch {
+		unsigned target; // ROM offset
+		unsigned offset; // ROM offset
+		branch_kind kind;
+	};
+
+	struct code_range {
+		unsigned begin; // ROM offset
+		unsigned end;
+		bool isThumb;
+	};
+
+	using rom_range = std::pair<unsigned, unsigned>; // [begin, end) ROM offsets
+
+public:
+	/* indexes the branches found in the code ranges (which may overlap), leaving out those with any byte in an excluded range */
+	void build(std::span<const std::uint8_t> rom, std::vector<code_range> code, std::vector<rom_range> excluded);
+
+	std::span<const branch> branches_to(unsigned target) const;
+
+	std::size_t size() const { return mBranches.size(); }
+
+	/* whether a branch of the given kind at offset can reach target */
+	static bool can_reach(branch_kind kind, unsigned offset, unsigned target);
+
+private:
+	std::vector<branch> mBranches; // sorted by target
+};
+
+} // namespace lyn
+
+#endif // BRANCH_INDEX_H
@@ -0,0 +1,259 @@
+#include "content_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <system_error>
+#include <vector>
+
+#include "config.h"
+
+#include "file_cache.h"
+#include "hash.h"
+#include "text_parse.h"
+
+namespace lyn {
+
+content_cache::content_cache(std::filesystem::path directory, std::string extension, std::uintmax_t maxSize)
+	: mDirectory(std::move(directory)), mExtension(std::move(extension)), mMaxSize(maxSize) {
+	if (mDirectory.empty())
+		return;
+
+	std::error_code error;
+	std::filesystem::create_directories(mDirectory, error);
+}
+
+std::uintmax_t content_cache::default_max_size() {
+	unsigned long long megabytes = 256;
+
+	if (const char* value = std::getenv("LYN_CACHE_SIZE")) {
+		unsigned long long parsed = 0;
+
+		if (parse_config_number(value, parsed) && parsed < (1ull << 40))
+			megabytes = parsed;
+	}
+
+	return megabytes << 20;
+}
+
+std::uint64_t content_cache::key_seed() {
+	// entries made by other versions of lyn may not hold what this one would make of the same inputs
+
+	return hash_string(PROJECT_VERSION);
+}
+
+std::uint64_t content_cache::key_of(std::span<const std::uint8_t> contents) {
+	return hash_bytes(contents, key_seed() ^ contents.size());
+}
+
+void content_cache::set_memory_limit(std::uintmax_t maxSize) {
+	std::lock_guard lock(mMutex);
+
+	mMemoryLimit = maxSize;
+
+	if (maxSize == 0) {
+		mMemoryEntries.clear();
+		mKnownFiles.clear();
+
+		mMemorySize = 0;
+	}
+}
+
+std::uint64_t content_cache::file_key(const std::string& fileName) {
+	std::unique_lock lock(mMutex);
+
+	if (mMemoryLimit == 0) {
+		lock.unlock();
+
+		const mapped_file file(fileName);
+		return key_of(file.bytes());
+	}
+
+	// files are known by absolute path, as relative ones depend on the working directory of each link
+	// the stamp is taken before reading, so that a file changing while it is read is read again the next time
+
+	std::error_code error;
+
+	auto path = std::filesystem::absolute(fileName, error).lexically_normal().string();
+	file_stamp stamp { std::filesystem::file_size(fileName, error), {} };
+
+	if (!error)
+		stamp.time = std::filesystem::last_write_time(fileName, error);
+
+	if (!error) {
+		if (auto it = mKnownFiles.find(path); it != mKnownFiles.end() && it->second.stamp == stamp)
+			return it->second.key;
+	}
+
+	lock.unlock();
+
+	const mapped_file file(fileName);
+	const auto key = key_of(file.bytes());
+
+	lock.lock();
+
+	if (!error)
+		mKnownFiles[path] = { stamp, key };
+
+	return key;
+}
+
+std::optional<content_cache::entry> content_cache::find(std::uint64_t key) {
+	std::unique_lock lock(mMutex);
+
+	if (auto it = mMemoryEntries.find(key); it != mMemoryEntries.end()) {
+		it->second.lastUse = ++mUseCounter;
+
+		auto& data = it->second.data;
+		return entry { entry_path(key).string(), *data, data };
+	}
+
+	if (mDirectory.empty())
+		return std::nullopt;
+
+	const bool isInMemory = mMemoryLimit != 0;
+
+	lock.unlock();
+
+	auto path = entry_path(key);
+
+	std::error_code error;
+
+	if (!std::filesystem::is_regular_file(path, error))
+		return std::nullopt;
+
+	try {
+		auto file = std::make_shared<const mapped_file>(path.string());
+
+		if (isInMemory) {
+			auto data = std::make_shared<const std::vector<std::uint8_t>>(file->data(), file->data() + file->size());
+
+			lock.lock();
+			keep_in_memory(key, data);
+
+			return entry { path.string(), *data, data };
+		}
+
+		return entry { path.string(), file->bytes(), file };
+	} catch (const std::exception&) {
+		return std::nullopt;
+	}
+}
+
+void content_cache::record_hit(std::uint64_t key, statistics& stats) {
+	stats.hits++;
+
+	if (mDirectory.empty())
+		return;
+
+	// the modification time of entries is their last use, which is what trim() goes by
+
+	std::error_code error;
+	std::filesystem::last_write_time(entry_path(key), std::filesystem::file_time_type::clock::now(), error);
+}
+
+void content_cache::store(std::uint64_t key, std::span<const std::uint8_t> contents, statistics& stats) {
+	stats.misses++;
+
+	{
+		std::lock_guard lock(mMutex);
+
+		if (mMemoryLimit != 0)
+			keep_in_memory(key, std::make_shared<const std::vector<std::uint8_t>>(contents.begin(), contents.end()));
+	}
+
+	if (mDirectory.empty())
+		return;
+
+	try {
+		replace_file(entry_path(key), contents);
+
+		std::lock_guard lock(mMutex);
+		mHasStored = true;
+	} catch (const std::exception&) {
+		// not being able to cache only makes the next link slower
+	}
+}
+
+void content_cache::trim(statistics& stats) {
+	{
+		std::lock_guard lock(mMutex);
+
+		if (!mHasStored || mDirectory.empty())
+			return;
+
+		mHasStored = false;
+	}
+
+	struct entry_info {
+		std::filesystem::path path;
+		std::uintmax_t size;
+		std::filesystem::file_time_type lastUse;
+	};
+
+	std::vector<entry_info> entries;
+	std::uintmax_t total = 0;
+
+	std::error_code error;
+
+	for (auto it = std::filesystem::directory_iterator(mDirectory, error); !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+		if (it->path().extension() != mExtension)
+			continue;
+
+		std::error_code entryError;
+
+		auto size = it->file_size(entryError);
+		auto lastUse = it->last_write_time(entryError);
+
+		if (entryError)
+			continue;
+
+		entries.push_back({ it->path(), size, lastUse });
+		total += size;
+	}
+
+	if (total > mMaxSize) {
+		std::sort(entries.begin(), entries.end(), [] (const entry_info& a, const entry_info& b) {
+			return a.lastUse < b.lastUse;
+		});
+
+		for (auto& entry : entries) {
+			if (total <= mMaxSize)
+				break;
+
+			if (std::filesystem::remove(entry.path, error)) {
+				total -= entry.size;
+				stats.evictions++;
+			}
+		}
+	}
+}
+
+std::filesystem::path content_cache::entry_path(std::uint64_t key) const {
+	return mDirectory / std::format("{0:016X}{1}", key, mExtension);
+}
+
+void content_cache::keep_in_memory(std::uint64_t key, std::shared_ptr<const std::vector<std::uint8_t>> data) {
+	auto& memoryEntry = mMemoryEntries[key];
+
+	if (memoryEntry.data)
+		mMemorySize -= memoryEntry.data->size();
+
+	mMemorySize += data->size();
+
+	memoryEntry.data = std::move(data);
+	memoryEntry.lastUse = ++mUseCounter;
+
+	// least recently used first, but never the entry just added (even if it is bigger than the limit by itself)
+
+	while (mMemorySize > mMemoryLimit && mMemoryEntries.size() > 1) {
+		auto oldest = std::min_element(mMemoryEntries.begin(), mMemoryEntries.end(), [] (const auto& a, const auto& b) {
+			return a.second.lastUse < b.second.lastUse;
+		});
+
+		mMemorySize -= oldest->second.data->size();
+		mMemoryEntries.erase(oldest);
+	}
+}
+
+} // namespace lyn
@@ -0,0 +1,131 @@
+#ifndef CONTENT_CACHE_H
+#define CONTENT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace lyn {
+
+/*!
+ * \brief directory of cached files, keyed on a hash of what they were made from
+ *
+ * This is used to keep loaded objects (as prepared objects, see
+ * lyn::prepared_writer) and whole link outputs between runs. Keys are hashes
+ * of the inputs, seeded with the lyn version, so that changing either gives
+ * another key.
+ *
+ * A cache is bounded in size. Entries are touched when used, and the least
+ * recently used ones are removed by trim() once the cache grows over its
+ * size. Failing to write entries isn't an error, the cache is just skipped.
+ *
+ * Long running processes (lyn serve) can also keep entries in memory, along
+ * with the keys of the files they saw (by path, size and modification time),
+ * so that unchanged files are neither read nor hashed again. Without a
+ * directory, the cache is in memory only.
+ *
+ * A cache can be used by several threads at once (as by lyn batch). Links
+ * sharing a cache count what it did for each of them on their own, through
+ * the statistics they give it.
+ *
+ */
+class content_cache {
+public:
+	// (counted by several threads at once when objects are loaded in parallel)
+	struct statistics {
+		std::atomic<unsigned> hits = 0;
+		std::atomic<unsigned> misses = 0;
+		std::atomic<unsigned> evictions = 0;
+	};
+
+	struct entry {
+		std::string name; // for messages
+		std::span<const std::uint8_t> bytes;
+
+		std::shared_ptr<const void> storage; // what holds the bytes (a mapped file or a copy in memory)
+	};
+
+public:
+	/* entries are the files with that extension in the directory (which is created if needed) */
+	content_cache(std::filesystem::path directory, std::string extension, std::uintmax_t maxSize);
+
+	/* size limit from $LYN_CACHE_SIZE (in MiB), 256MiB by default */
+	static std::uintmax_t default_max_size();
+
+	/* seed for keys, keys of things made of several inputs are hashed one input after the other from this */
+	static std::uint64_t key_seed();
+
+	/* key of something made from these contents alone */
+	static std::uint64_t key_of(std::span<const std::uint8_t> contents);
+
+	/* keeps up to maxSize bytes of entries in memory (0 to stop), and remembers file keys */
+	void set_memory_limit(std::uintmax_t maxSize);
+
+	/* key_of the contents of a file, which in memory mode isn't read again as long as its size and modification time stay the same */
+	std::uint64_t file_key(const std::string& fileName);
+
+	/* the entry for that key, if there's one
+	 * (this doesn't count as a hit yet, as the entry may turn out to be damaged or outdated) */
+	std::optional<entry> find(std::uint64_t key);
+
+	void record_hit(std::uint64_t key, statistics& stats);
+
+	/* adds (or replaces) the entry for that key, which counts as a miss */
+	void store(std::uint64_t key, std::span<const std::uint8_t> contents, statistics& stats);
+
+	/* removes the least recently used entries until the cache fits its size again, counting them as evicted
+	 * this only looks at the directory when something was stored */
+	void trim(statistics& stats);
+
+private:
+	struct memory_entry {
+		std::shared_ptr<const std::vector<std::uint8_t>> data;
+		std::uint64_t lastUse;
+	};
+
+	struct file_stamp {
+		std::uintmax_t size;
+		std::filesystem::file_time_type time;
+
+		bool operator == (const file_stamp& other) const = default;
+	};
+
+	struct known_file {
+		file_stamp stamp;
+		std::uint64_t key;
+	};
+
+	std::filesystem::path entry_path(std::uint64_t key) const;
+
+	// (with mMutex held)
+	void keep_in_memory(std::uint64_t key, std::shared_ptr<const std::vector<std::uint8_t>> data);
+
+	// guards everything below, but not the directory (files in it are only ever replaced whole)
+	mutable std::mutex mMutex;
+
+	std::filesystem::path mDirectory;
+	std::string mExtension;
+	std::uintmax_t mMaxSize;
+
+	bool mHasStored = false;
+
+	std::uintmax_t mMemoryLimit = 0;
+	std::uintmax_t mMemorySize = 0;
+	std::uint64_t mUseCounter = 0;
+
+	std::unordered_map<std::uint64_t, memory_entry> mMemoryEntries;
+	std::unordered_map<std::string, known_file> mKnownFiles;
+};
+
+} // namespace lyn
+
+#endif // CONTENT_CACHE_H
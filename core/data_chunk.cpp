@@ -1,14 +1,14 @@
 #include "data_chunk.h"
 
+#include <cstring>
+
 namespace lyn {
 
 bool data_chunk::is_cstr_at(unsigned pos) const {
-	do {
-		if (!at(pos))
-			return true;
-	} while ((++pos) < size());
+	if (pos >= size())
+		return false;
 
-	return false;
+	return std::memchr(data() + pos, 0, size() - pos) != nullptr;
 }
 
 const char* data_chunk::cstr_at(unsigned pos) const {
@@ -1,17 +1,71 @@
 #ifndef DATA_CHUNK_H
 #define DATA_CHUNK_H
 
-#include <vector>
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <vector>
 
 namespace lyn {
 
-struct data_chunk : public std::vector<std::uint8_t> {
-	using std::vector<std::uint8_t>::vector;
+/* unchecked little endian integer access, for use once a range has been validated
+ * (std::byteswap is C++23, so we swap by hand on big endian hosts) */
+
+template<typename IntType, unsigned ByteCount = sizeof(IntType)>
+inline IntType load_le(const std::uint8_t* data) {
+	static_assert(ByteCount <= sizeof(IntType));
+
+	if constexpr (std::endian::native == std::endian::little && ByteCount == sizeof(IntType)) {
+		IntType result;
+		std::memcpy(&result, data, sizeof(IntType));
+
+		return result;
+	} else {
+		IntType result = 0;
+
+		for (unsigned i = 0; i < ByteCount; ++i)
+			result |= static_cast<IntType>(data[i]) << (i * 8);
+
+		return result;
+	}
+}
+
+template<typename IntType, unsigned ByteCount = sizeof(IntType)>
+inline void store_le(std::uint8_t* data, IntType value) {
+	static_assert(ByteCount <= sizeof(IntType));
+
+	if constexpr (std::endian::native == std::endian::little && ByteCount == sizeof(IntType)) {
+		std::memcpy(data, &value, sizeof(IntType));
+	} else {
+		for (unsigned i = 0; i < ByteCount; ++i)
+			data[i] = (value >> (i * 8)) & 0xFF;
+	}
+}
+
+/* a pmr vector, so that chunks can live in the arena of whatever owns them */
+
+struct data_chunk : public std::pmr::vector<std::uint8_t> {
+	using std::pmr::vector<std::uint8_t>::vector;
 
 	bool is_cstr_at(unsigned pos) const;
 	const char* cstr_at(unsigned pos) const;
 
+	/* range checked access to several bytes at once
+	 * throws std::out_of_range like at() if [pos, pos+count) isn't in the chunk */
+
+	std::span<const value_type> bytes(unsigned pos, unsigned count) const {
+		check_range(pos, count);
+		return { data() + pos, count };
+	}
+
+	std::span<value_type> bytes(unsigned pos, unsigned count) {
+		check_range(pos, count);
+		return { data() + pos, count };
+	}
+
 	template<typename IntType, unsigned ByteCount = sizeof(IntType)>
 	IntType read(unsigned pos) const;
 
@@ -20,22 +74,24 @@ struct data_chunk : public std::vector<std::uint8_t> {
 
 	value_type read_byte(unsigned pos) const;
 	void write_byte(unsigned pos, value_type value);
+
+private:
+	void check_range(unsigned pos, unsigned count) const {
+		if (pos > size() || count > (size() - pos))
+			throw std::out_of_range("data_chunk access out of range");
+	}
 };
 
 template<typename IntType, unsigned ByteCount>
 IntType data_chunk::read(unsigned pos) const {
-	IntType result = 0;
-
-	for (unsigned i=0; i<ByteCount; ++i)
-		result |= (read_byte(pos + i) << (i*8));
-
-	return result;
+	check_range(pos, ByteCount);
+	return load_le<IntType, ByteCount>(data() + pos);
 }
 
 template<typename IntType, unsigned ByteCount>
 void data_chunk::write(unsigned pos, IntType value) {
-	for (unsigned i=0; i<ByteCount; ++i)
-		write_byte(pos + i, (value >> (i*8)) & 0xFF);
+	check_range(pos, ByteCount);
+	store_le<IntType, ByteCount>(data() + pos, value);
 }
 
 } // namespace lyn
@@ -0,0 +1,248 @@
+#include "elf_index.h"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "data_chunk.h"
+
+#include "elfcpp/elfcpp.h"
+#include "elfcpp/arm.h"
+
+namespace lyn {
+
+namespace {
+
+constexpr unsigned SHDR_SIZE = 40;
+constexpr unsigned SYM_SIZE  = 16;
+constexpr unsigned REL_SIZE  = 8;
+constexpr unsigned RELA_SIZE = 12;
+
+bool in_bounds(std::size_t size, std::uint64_t offset, std::uint64_t length) {
+	return offset <= size && length <= size - offset;
+}
+
+[[noreturn]] void fail_file(std::string_view fileName, std::string_view what) {
+	throw std::runtime_error(std::format("{0}: {1}", fileName, what));
+}
+
+} // namespace
+
+elf_index::elf_index(std::string_view fileName, std::span<const std::uint8_t> data)
+	: mFileName(fileName), mData(data) {
+	check_header(fileName, data);
+
+	const std::uint8_t* base = data.data();
+
+	const unsigned shoff     = load_le<std::uint32_t>(base + 32);
+	const unsigned shentsize = load_le<std::uint16_t>(base + 46);
+	const unsigned shnum     = load_le<std::uint16_t>(base + 48);
+	const unsigned shstrndx  = load_le<std::uint16_t>(base + 50);
+
+	if (shnum != 0 && (shentsize < SHDR_SIZE || !in_bounds(data.size(), shoff, std::uint64_t(shentsize) * shnum)))
+		fail("bad section header table");
+
+	// section headers
+
+	mSections.resize(shnum);
+
+	std::size_t symbolCount = 0;
+	std::size_t relocationCount = 0;
+
+	for (unsigned i = 0; i < shnum; ++i) {
+		const std::uint8_t* header = base + shoff + i * shentsize;
+		section& sect = mSections[i];
+
+		sect.type    = load_le<std::uint32_t>(header + 4);
+		sect.flags   = load_le<std::uint32_t>(header + 8);
+		sect.offset  = load_le<std::uint32_t>(header + 16);
+		sect.size    = load_le<std::uint32_t>(header + 20);
+		sect.link    = load_le<std::uint32_t>(header + 24);
+		sect.info    = load_le<std::uint32_t>(header + 28);
+		sect.entsize = load_le<std::uint32_t>(header + 36);
+
+		sect.firstEntry = 0;
+		sect.entryCount = 0;
+
+		if (sect.type != elfcpp::SHT_NOBITS && sect.type != elfcpp::SHT_NULL && !in_bounds(data.size(), sect.offset, sect.size))
+			fail(std::format("section #{0} is out of the file", i));
+
+		switch (sect.type) {
+
+		case elfcpp::SHT_SYMTAB:
+			if (sect.entsize < SYM_SIZE || sect.link >= shnum)
+				fail(std::format("bad symbol table #{0}", i));
+
+			sect.entryCount = sect.size / sect.entsize;
+			symbolCount += sect.entryCount;
+
+			break;
+
+		case elfcpp::SHT_REL:
+		case elfcpp::SHT_RELA:
+			if (sect.entsize < (sect.type == elfcpp::SHT_REL ? REL_SIZE : RELA_SIZE) || sect.link >= shnum || sect.info >= shnum)
+				fail(std::format("bad relocation table #{0}", i));
+
+			sect.entryCount = sect.size / sect.entsize;
+			relocationCount += sect.entryCount;
+
+			break;
+
+		}
+	}
+
+	if (shstrndx != elfcpp::SHN_UNDEF) {
+		if (shstrndx >= shnum || mSections[shstrndx].type != elfcpp::SHT_STRTAB)
+			fail("bad section name table");
+
+		for (unsigned i = 0; i < shnum; ++i)
+			mSections[i].name = string_at(mSections[shstrndx], load_le<std::uint32_t>(base + shoff + i * shentsize));
+	}
+
+	// symbol tables, then relocation tables (which refer to them)
+
+	mSymbols.reserve(symbolCount);
+	mRelocations.reserve(relocationCount);
+
+	for (unsigned i = 0; i < shnum; ++i) {
+		section& sect = mSections[i];
+
+		if (sect.type != elfcpp::SHT_SYMTAB)
+			continue;
+
+		const section& strtab = mSections[sect.link];
+
+		if (strtab.type != elfcpp::SHT_STRTAB || strtab.size == 0 || base[strtab.offset + strtab.size - 1] != 0)
+			fail(std::format("symbol table #{0} isn't linked to a terminated string table", i));
+
+		// the string table ends with a terminator, so any offset in it is the start of a valid string
+		// we can then get away with a single compare per name, and leave measuring them to users
+
+		sect.firstEntry = mSymbols.size();
+
+		for (unsigned j = 0; j < sect.entryCount; ++j) {
+			const std::uint8_t* entry = base + sect.offset + j * sect.entsize;
+			symbol& sym = mSymbols.emplace_back();
+
+			sym.name  = load_le<std::uint32_t>(entry);
+
+			if (sym.name >= strtab.size)
+				fail(std::format("name of symbol #{0} of table #{1} is out of its string table", j, i));
+			sym.value = load_le<std::uint32_t>(entry + 4);
+			sym.size  = load_le<std::uint32_t>(entry + 8);
+			sym.bind  = entry[12] >> 4;
+			sym.type  = entry[12] & 0xF;
+			sym.shndx = load_le<std::uint16_t>(entry + 14);
+		}
+	}
+
+	for (unsigned i = 0; i < shnum; ++i) {
+		section& sect = mSections[i];
+
+		if (sect.type != elfcpp::SHT_REL && sect.type != elfcpp::SHT_RELA)
+			continue;
+
+		const section& symtab = mSections[sect.link];
+
+		if (symtab.type != elfcpp::SHT_SYMTAB)
+			fail(std::format("relocation table #{0} isn't linked to a symbol table", i));
+
+		const bool hasAddend = (sect.type == elfcpp::SHT_RELA);
+
+		sect.firstEntry = mRelocations.size();
+
+		for (unsigned j = 0; j < sect.entryCount; ++j) {
+			const std::uint8_t* entry = base + sect.offset + j * sect.entsize;
+			relocation& rel = mRelocations.emplace_back();
+
+			const std::uint32_t info = load_le<std::uint32_t>(entry + 4);
+
+			rel.offset = load_le<std::uint32_t>(entry);
+			rel.symbol = info >> 8;
+			rel.type   = info & 0xFF;
+			rel.addend = hasAddend ? load_le<std::int32_t>(entry + 8) : 0;
+
+			if (rel.symbol >= symtab.entryCount)
+				fail(std::format("relocation #{0} of table #{1} refers to a symbol that doesn't exist", j, i));
+		}
+	}
+}
+
+void elf_index::check_header(std::string_view fileName, std::span<const std::uint8_t> header) {
+	const std::uint8_t* base = header.data();
+
+	if (header.size() < HEADER_SIZE || std::memcmp(base, "\x7F" "ELF", 4) != 0)
+		fail_file(fileName, "not an ELF file");
+
+	if (base[elfcpp::EI_CLASS] != elfcpp::ELFCLASS32 || base[elfcpp::EI_DATA] != elfcpp::ELFDATA2LSB)
+		fail_file(fileName, "not a 32-bit little endian ELF file");
+
+	const unsigned type    = load_le<std::uint16_t>(base + 16);
+	const unsigned machine = load_le<std::uint16_t>(base + 18);
+
+	if (machine != elfcpp::EM_ARM)
+		fail_file(fileName, std::format("not an ARM ELF file (machine {0})", machine));
+
+	if (type != elfcpp::ET_REL)
+		fail_file(fileName, std::format("not a relocatable object (type {0})", type));
+}
+
+void elf_index::check_file_header(const std::string& fileName) {
+	std::ifstream input(fileName, std::ios::in | std::ios::binary);
+
+	if (!input.is_open())
+		throw std::runtime_error(std::format("Couldn't open file for read: {0}", fileName));
+
+	std::uint8_t header[HEADER_SIZE];
+
+	input.read(reinterpret_cast<char*>(header), HEADER_SIZE);
+	check_header(fileName, std::span<const std::uint8_t>(header, input.gcount()));
+}
+
+std::span<const std::uint8_t> elf_index::contents(unsigned sectionIndex) const {
+	const section& sect = mSections.at(sectionIndex);
+
+	if (sect.type == elfcpp::SHT_NOBITS || sect.type == elfcpp::SHT_NULL)
+		return {};
+
+	return mData.subspan(sect.offset, sect.size);
+}
+
+std::span<const elf_index::symbol> elf_index::symbols(unsigned sectionIndex) const {
+	const section& sect = mSections.at(sectionIndex);
+
+	if (sect.type != elfcpp::SHT_SYMTAB)
+		return {};
+
+	return std::span<const symbol>(mSymbols).subspan(sect.firstEntry, sect.entryCount);
+}
+
+std::span<const elf_index::relocation> elf_index::relocations(unsigned sectionIndex) const {
+	const section& sect = mSections.at(sectionIndex);
+
+	if (sect.type != elfcpp::SHT_REL && sect.type != elfcpp::SHT_RELA)
+		return {};
+
+	return std::span<const relocation>(mRelocations).subspan(sect.firstEntry, sect.entryCount);
+}
+
+std::string_view elf_index::string_at(const section& strtab, unsigned offset) const {
+	if (offset >= strtab.size)
+		fail(std::format("string at {0} is out of its table", offset));
+
+	const char* begin = reinterpret_cast<const char*>(mData.data() + strtab.offset + offset);
+	const void* end = std::memchr(begin, 0, strtab.size - offset);
+
+	if (!end)
+		fail(std::format("string at {0} isn't terminated", offset));
+
+	return std::string_view(begin, static_cast<const char*>(end) - begin);
+}
+
+void elf_index::fail(std::string_view what) const {
+	fail_file(mFileName, what);
+}
+
+} // namespace lyn
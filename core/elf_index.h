@@ -0,0 +1,107 @@
+#ifndef ELF_INDEX_H
+#define ELF_INDEX_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief the tables of a 32-bit little endian ELF object, decoded in one go
+ *
+ * The section header table, symbol tables and relocation tables are checked
+ * against the bounds of the file once, and decoded into plain arrays. Names
+ * are views into the file data, which has to outlive the index.
+ *
+ * Any malformed table makes the constructor throw. Symbol names are only
+ * checked to be in a terminated string table, they are measured when used.
+ *
+ * Only ARM relocatable objects are accepted. check_file_header can tell
+ * whether a file is one from its first HEADER_SIZE bytes, so that a wrong
+ * input is rejected without being read whole.
+ *
+ */
+class elf_index {
+public:
+	struct section {
+		std::string_view name;
+
+		unsigned type;
+		unsigned flags;
+		unsigned offset;
+		unsigned size;
+		unsigned link;
+		unsigned info;
+		unsigned entsize;
+
+		// symbol and relocation tables: where their entries are in mSymbols or mRelocations
+		unsigned firstEntry;
+		unsigned entryCount;
+	};
+
+	/* as compact as the symbols in the file, so that looking them up randomly doesn't cost more than reading the file would */
+
+	struct symbol {
+		unsigned name; // offset in the linked string table, see symbol_name
+
+		unsigned value;
+		unsigned size;
+
+		std::uint16_t shndx;
+		std::uint8_t bind;
+		std::uint8_t type;
+	};
+
+	struct relocation {
+		unsigned offset;
+		unsigned symbol; // index in the linked symbol table
+		unsigned type;
+		int addend; // 0 for REL
+	};
+
+public:
+	static constexpr unsigned HEADER_SIZE = 52;
+
+	elf_index(std::string_view fileName, std::span<const std::uint8_t> data);
+
+	/* throws unless the header is the one of a 32-bit little endian ARM relocatable object */
+	static void check_header(std::string_view fileName, std::span<const std::uint8_t> header);
+
+	/* same as check_header, reading only the header from the file */
+	static void check_file_header(const std::string& fileName);
+
+	const std::vector<section>& sections() const { return mSections; }
+
+	/* contents of a section in the file, empty for SHT_NOBITS */
+	std::span<const std::uint8_t> contents(unsigned sectionIndex) const;
+
+	/* entries of a SHT_SYMTAB section */
+	std::span<const symbol> symbols(unsigned sectionIndex) const;
+
+	/* name of an entry of the SHT_SYMTAB section at sectionIndex */
+	const char* symbol_name(unsigned sectionIndex, const symbol& sym) const {
+		return reinterpret_cast<const char*>(mData.data()) + mSections[mSections[sectionIndex].link].offset + sym.name;
+	}
+
+	/* entries of a SHT_REL or SHT_RELA section */
+	std::span<const relocation> relocations(unsigned sectionIndex) const;
+
+private:
+	std::string_view string_at(const section& strtab, unsigned offset) const;
+
+	[[noreturn]] void fail(std::string_view what) const;
+
+	std::string_view mFileName;
+	std::span<const std::uint8_t> mData;
+
+	std::vector<section> mSections;
+	std::vector<symbol> mSymbols;
+	std::vector<relocation> mRelocations;
+};
+
+} // namespace lyn
+
+#endif // ELF_INDEX_H
@@ -1,327 +1,1100 @@
 #include "event_object.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
 #include <format>
+#include <iterator>
+#include <memory>
+#include <numeric>
 #include <ostream>
+#include <sstream>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 
-#include "elfcpp/elfcpp_file.h"
+#include "elfcpp/elfcpp.h"
 #include "elfcpp/arm.h"
 
-#include "core/data_file.h"
+#include "core/ar_archive.h"
+#include "core/elf_index.h"
+#include "core/mapped_file.h"
+#include "core/parallel.h"
+#include "core/relocation_batch.h"
+#include "core/symbol_list.h"
 #include "ea/event_section.h"
 
-namespace elfcpp {
+namespace lyn {
+
+void event_object::append_from_elf(const char* fileName)
+{
+	// a wrong input (say a ROM picked up by a glob) is rejected from its header alone, before reading all of it
 
-// for some reason this is required in order to make the whole thing work
+	elf_index::check_file_header(fileName);
 
-template<int Size, bool BigEndian, typename File>
-const int Elf_file<Size, BigEndian, File>::ehdr_size;
+	// with a cache, the object may not even need to be read (see content_cache::file_key)
 
-template<int Size, bool BigEndian, typename File>
-const int Elf_file<Size, BigEndian, File>::phdr_size;
+	if (!mObjectCache || !append_from_cache(mObjectCache->file_key(fileName)))
+	{
+		const mapped_file file(fileName);
+		append_from_elf(fileName, file.bytes());
+	}
 
-template<int Size, bool BigEndian, typename File>
-const int Elf_file<Size, BigEndian, File>::shdr_size;
+	mInputFiles.push_back(fileName);
+}
 
-template<int Size, bool BigEndian, typename File>
-const int Elf_file<Size, BigEndian, File>::sym_size;
+void event_object::append_from_elf(std::string_view name, std::span<const std::uint8_t> data)
+{
+	if (!mObjectCache)
+	{
+		load_elf(name, data);
+		return;
+	}
 
-template<int Size, bool BigEndian, typename File>
-const int Elf_file<Size, BigEndian, File>::rel_size;
+	const auto key = content_cache::key_of(data);
 
-template<int Size, bool BigEndian, typename File>
-const int Elf_file<Size, BigEndian, File>::rela_size;
+	if (append_from_cache(key))
+		return;
 
-} // namespace elfcpp
+	const auto sectionBegin = mSections.size();
+	const auto absoluteBegin = mAbsoluteSymbols.size();
 
-namespace lyn {
+	load_elf(name, data);
 
-void event_object::append_from_elf(const char* fileName)
+	mObjectCache->store(key, make_prepared(sectionBegin, absoluteBegin).bytes(), *mObjectCacheStats);
+}
+
+void event_object::append_from_objects(const std::vector<std::string>& fileNames)
 {
-	data_file file(fileName);
+	if (fileNames.size() < 2 || !can_run_parallel())
+	{
+		for (auto& fileName : fileNames)
+		{
+			if (prepared_reader::is_prepared_file(fileName))
+				append_from_prepared(fileName.c_str());
+			else
+				append_from_elf(fileName.c_str());
+		}
 
-	elfcpp::Elf_file<32, false, lyn::data_file> elfFile(&file);
+		return;
+	}
+
+	// each object is loaded as a prepared object of its own, appending those is then little more than copying them
+
+	std::vector<loaded_object> objects(fileNames.size());
 
-	auto readString = [&file] (elfcpp::Shdr<32, false> section, unsigned offset) -> std::string
+	parallel_for(fileNames.size(), [this, &fileNames, &objects] (std::size_t i)
 	{
-		return file.cstr_at(section.get_sh_offset() + offset);
-	};
+		try
+		{
+			objects[i] = load_object(fileNames[i]);
+		}
+		catch (...)
+		{
+			objects[i].error = std::current_exception();
+		}
+	});
+
+	// (errors are reported in order, as if the objects were loaded one after the other)
+
+	for (std::size_t i = 0; i < fileNames.size(); ++i)
+	{
+		auto& object = objects[i];
+
+		if (object.error)
+			std::rethrow_exception(object.error);
+
+		try
+		{
+			append_from_prepared(object.prepared.name, object.prepared.bytes);
+		}
+		catch (const std::exception&)
+		{
+			if (!object.cacheKey)
+				throw;
+
+			// a damaged or outdated entry is replaced, as if there was none
+
+			append_from_elf(fileNames[i].c_str());
+			continue;
+		}
+
+		if (object.cacheKey)
+			mObjectCache->record_hit(*object.cacheKey, *mObjectCacheStats);
+
+		mInputFiles.push_back(fileNames[i]);
+	}
+}
 
-	std::vector<section_data> newSections(elfFile.shnum());
-	std::vector<bool> outMap(elfFile.shnum(), false);
+event_object::loaded_object event_object::load_object(const std::string& fileName) const
+{
+	loaded_object result;
 
-	auto getLocalSymbolName = [this] (int section, int index) -> std::string
+	if (prepared_reader::is_prepared_file(fileName))
 	{
-		return std::format("_L{0:X}_{1:X}", mSections.size() + section, index);
+		auto file = std::make_shared<const mapped_file>(fileName);
+		result.prepared = { fileName, file->bytes(), file };
+
+		return result;
+	}
+
+	elf_index::check_file_header(fileName);
+
+	std::uint64_t key = 0;
+
+	if (mObjectCache)
+	{
+		key = mObjectCache->file_key(fileName);
+
+		if (auto entry = mObjectCache->find(key))
+		{
+			result.prepared = std::move(*entry);
+			result.cacheKey = key;
+
+			return result;
+		}
+	}
+
+	const mapped_file file(fileName);
+
+	event_object object;
+	object.load_elf(fileName, file.bytes());
+
+	auto writer = object.make_prepared(0, 0);
+
+	if (mObjectCache)
+		mObjectCache->store(key, writer.bytes(), *mObjectCacheStats);
+
+	auto data = std::make_shared<const std::vector<std::uint8_t>>(std::move(writer).take_bytes());
+	result.prepared = { fileName, *data, data };
+
+	return result;
+}
+
+bool event_object::append_from_cache(std::uint64_t key)
+{
+	auto entry = mObjectCache->find(key);
+
+	if (!entry)
+		return false;
+
+	try
+	{
+		append_from_prepared(entry->name, entry->bytes);
+		mObjectCache->record_hit(key, *mObjectCacheStats);
+
+		return true;
+	}
+	catch (const std::exception&)
+	{
+		// a damaged or outdated entry is replaced, as if there was none
+		return false;
+	}
+}
+
+void event_object::load_elf(std::string_view name, std::span<const std::uint8_t> data)
+{
+	const elf_index elf(name, data);
+	const auto& headers = elf.sections();
+
+	// sections are built in the arena directly, so that adding them to the object doesn't copy them
+
+	std::pmr::vector<section_data> newSections(headers.size(), &mArena);
+	std::vector<bool> outMap(headers.size(), false);
+
+	// mapping symbols are gathered first so that each section only sorts its mappings once
+
+	std::vector<std::vector<section_data::mapping>> newMappings(headers.size());
+
+	// locals are named by key, only those that make it to the output will get a textual name
+
+	auto getLocalSymbolName = [this] (int section, int index) -> symbol_ref
+	{
+		return symbol_ref::local(mSections.size() + section, index);
 	};
 
-	auto getGlobalSymbolName = [] (const char* name) -> std::string
+	// global names are only needed until they are added to a string pool
+	// so those with dots are fixed in one reused buffer rather than each in a new string
+
+	std::string nameBuffer;
+
+	auto getGlobalSymbolName = [&nameBuffer] (std::string_view name) -> std::string_view
 	{
-		std::string result(name);
-		std::size_t find = 0;
+		if (name.find('.') == std::string_view::npos)
+			return name;
 
-		while ((find = result.find('.')) != std::string::npos)
-			result[find] = '_';
+		nameBuffer.assign(name);
+		std::replace(nameBuffer.begin(), nameBuffer.end(), '.', '_');
 
-		return result;
+		return nameBuffer;
 	};
 
-	for (unsigned i = 0; i < elfFile.shnum(); ++i)
+	for (unsigned i = 0; i < headers.size(); ++i)
 	{
-		auto flags = elfFile.section_flags(i);
+		auto flags = headers[i].flags;
 
 		if ((flags & elfcpp::SHF_ALLOC) && !(flags & elfcpp::SHF_WRITE))
 		{
-			auto& section = newSections.at(i);
-			auto  loc     = elfFile.section_contents(i);
+			auto& section = newSections[i];
+			auto  contents = elf.contents(i);
 
 			// TODO: put filename in name (whenever name will be useful)
 
-			section.set_name(elfFile.section_name(i));
+			section.set_name(headers[i].name);
 
-			section.resize(loc.data_size);
+			// SHT_NOBITS sections have no contents in the file, and are zero filled
 
-			std::copy(
-				std::next(file.begin(), loc.file_offset),
-				std::next(file.begin(), loc.file_offset+loc.data_size),
-				section.begin());
+			if (contents.empty())
+				section.resize(headers[i].size);
+			else
+				section.assign(contents.begin(), contents.end());
 
 			outMap[i] = true;
 		}
 	}
 
-	for (unsigned si = 0; si < elfFile.shnum(); ++si)
+	// tables are sized up front, as growing them in the arena would leave the old storage behind
+	// so are name pools, which would otherwise each start with a block of their own (however few names the section has)
+
+	std::vector<unsigned> symbolCounts(headers.size(), 0);
+
+	std::vector<std::size_t> nameCounts(headers.size(), 0);
+	std::vector<std::size_t> nameSizes(headers.size(), 0);
+
+	// (sizes of the names of the globals of each symbol table, the pools get a copy of these for each symbol and relocation)
+
+	std::vector<std::vector<unsigned>> globalNameSizes(headers.size());
+
+	auto getGlobalNameSizes = [&elf, &globalNameSizes] (unsigned symtab) -> const std::vector<unsigned>&
+	{
+		auto& sizes = globalNameSizes[symtab];
+		auto symbols = elf.symbols(symtab);
+
+		if (sizes.size() != symbols.size())
+		{
+			sizes.resize(symbols.size());
+
+			for (unsigned i = 0; i < symbols.size(); ++i)
+				sizes[i] = (symbols[i].bind == elfcpp::STB_LOCAL) ? 0 : std::strlen(elf.symbol_name(symtab, symbols[i]));
+		}
+
+		return sizes;
+	};
+
+	for (unsigned si = 0; si < headers.size(); ++si)
+	{
+		if (headers[si].type == elfcpp::SHT_SYMTAB)
+		{
+			auto symbols = elf.symbols(si);
+			auto& sizes = getGlobalNameSizes(si);
+
+			for (unsigned i = 0; i < symbols.size(); ++i)
+			{
+				const unsigned shndx = symbols[i].shndx;
+
+				if (shndx >= headers.size())
+					continue;
+
+				symbolCounts[shndx]++;
+
+				if (symbols[i].bind != elfcpp::STB_LOCAL)
+				{
+					nameCounts[shndx]++;
+					nameSizes[shndx] += sizes[i];
+				}
+			}
+		}
+
+		if ((headers[si].type == elfcpp::SHT_REL || headers[si].type == elfcpp::SHT_RELA) && outMap[headers[si].info])
+		{
+			const unsigned target = headers[si].info;
+
+			newSections[target].relocations().reserve(newSections[target].relocations().size() + headers[si].entryCount);
+
+			auto symbols = elf.symbols(headers[si].link);
+			auto& sizes = getGlobalNameSizes(headers[si].link);
+
+			for (auto& rel : elf.relocations(si))
+			{
+				if (symbols[rel.symbol].bind != elfcpp::STB_LOCAL)
+				{
+					nameCounts[target]++;
+					nameSizes[target] += sizes[rel.symbol];
+				}
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < headers.size(); ++i)
+	{
+		if (outMap[i])
+		{
+			newSections[i].symbols().reserve(symbolCounts[i]);
+			newSections[i].names().reserve(nameCounts[i], nameSizes[i]);
+		}
+	}
+
+	for (unsigned si = 0; si < headers.size(); ++si)
 	{
-		elfcpp::Shdr<32, false> header(&file, elfFile.section_header(si));
+		const auto& header = headers[si];
 
-		switch (header.get_sh_type())
+		switch (header.type)
 		{
 
 		case elfcpp::SHT_SYMTAB:
 		{
-			const unsigned count = header.get_sh_size() / header.get_sh_entsize();
-			const elfcpp::Shdr<32, false> nameShdr(&file, elfFile.section_header(header.get_sh_link()));
+			auto symbols = elf.symbols(si);
 
-			for (unsigned i = 0; i < count; ++i)
+			for (unsigned i = 0; i < symbols.size(); ++i)
 			{
-				elfcpp::Sym<32, false> sym(&file, data_file::Location(
-					header.get_sh_offset() + i * header.get_sh_entsize(),
-					header.get_sh_entsize()
-				));
+				const auto& sym = symbols[i];
 
-				switch (sym.get_st_shndx())
+				switch (sym.shndx)
 				{
 
 				case elfcpp::SHN_ABS:
 				{
-					auto name = (sym.get_st_bind() == elfcpp::STB_LOCAL)
+					symbol_ref name = (sym.bind == elfcpp::STB_LOCAL)
 						? getLocalSymbolName(si, i)
-						: getGlobalSymbolName(readString(nameShdr, sym.get_st_name()).c_str());
+						: symbol_ref(getGlobalSymbolName(elf.symbol_name(si, sym)));
+
+					if (!name.is_local_key())
+						name = mAbsoluteNames.get(mAbsoluteNames.add(name.text()));
+
+					bool is_function = sym.type == elfcpp::STT_FUNC;
+
+					mAbsoluteSymbols.push_back(absolute_symbol {
+						name,
+						sym.value,
+						sym.size,
+						is_function,
+					});
+
+					break;
+				} // case elfcpp::SHN_ABS
+
+				default:
+				{
+					if (sym.shndx >= outMap.size())
+						break;
+
+					if (!outMap[sym.shndx])
+						break;
+
+					auto& section = newSections[sym.shndx];
+
+					std::string_view name = elf.symbol_name(si, sym);
+
+					if (sym.type == elfcpp::STT_NOTYPE && sym.bind == elfcpp::STB_LOCAL)
+					{
+						std::string_view subString = name.substr(0, 3);
+
+						if ((name == "$t") || (subString == "$t."))
+						{
+							newMappings[sym.shndx].push_back({ section_data::mapping::Thumb, sym.value });
+							break;
+						}
+
+						if ((name == "$a") || (subString == "$a."))
+						{
+							newMappings[sym.shndx].push_back({ section_data::mapping::ARM, sym.value });
+							break;
+						}
+
+						if ((name == "$d") || (subString == "$d."))
+						{
+							newMappings[sym.shndx].push_back({ section_data::mapping::Data, sym.value });
+							break;
+						}
+					}
+
+					symbol_ref ref = (sym.bind == elfcpp::STB_LOCAL)
+						? getLocalSymbolName(si, i)
+						: symbol_ref(getGlobalSymbolName(name));
+
+					bool is_local = sym.bind == elfcpp::STB_LOCAL;
+					bool is_function = sym.type == elfcpp::STT_FUNC;
+
+					section.add_symbol(ref, sym.value, sym.size, is_local, is_function);
+
+					break;
+				} // default
+
+				} // switch (sym.shndx)
+			}
+
+			break;
+		} // case elfcpp::SHT_SYMTAB
+
+		case elfcpp::SHT_REL:
+		case elfcpp::SHT_RELA:
+		{
+			if (!outMap[header.info])
+				break;
+
+			auto symbols = elf.symbols(header.link);
+			auto& section = newSections[header.info];
+
+			for (auto& rel : elf.relocations(si))
+			{
+				const auto& sym = symbols[rel.symbol];
+
+				const symbol_ref name = (sym.bind == elfcpp::STB_LOCAL)
+					? getLocalSymbolName(header.link, rel.symbol)
+					: symbol_ref(getGlobalSymbolName(elf.symbol_name(header.link, sym)));
+
+				section.add_relocation(name, rel.addend, rel.type, rel.offset);
+			}
+
+			break;
+		} // case elfcpp::SHT_REL, elfcpp::SHT_RELA
+
+		} // switch (header.type)
+	}
+
+	for (unsigned i = 0; i < headers.size(); ++i)
+		if (!newMappings[i].empty())
+			newSections[i].set_mappings(std::move(newMappings[i]));
+
+	// Remove empty sections
+
+	newSections.erase(std::remove_if(newSections.begin(), newSections.end(),
+		[] (const section_data& section)
+		{
+			return (section.size()==0);
+		}
+	), newSections.end());
+
+	// Add to existing section list
+	// (no exact reserve here: the arena never gets back what a reallocation leaves behind, so we let it grow geometrically)
+
+	mSections.insert(mSections.end(),
+		std::make_move_iterator(newSections.begin()),
+		std::make_move_iterator(newSections.end()));
+}
+
+void event_object::append_from_archives(const std::vector<std::string>& fileNames)
+{
+	struct archive_file
+	{
+		explicit archive_file(const std::string& fileName)
+			: file(fileName), archive(file.file_name(), file.bytes()) {}
+
+		mapped_file file;
+		ar_archive archive;
+	};
+
+	std::vector<std::unique_ptr<archive_file>> archives;
+
+	// which member defines what (the first archive defining a symbol wins, as with a linker)
+	// names get their dots replaced, as they are when loading objects
+
+	struct member_ref
+	{
+		unsigned archive;
+		unsigned offset;
+	};
+
+	std::unordered_map<std::string, member_ref> providers;
+
+	for (auto& fileName : fileNames)
+	{
+		auto& archive = *archives.emplace_back(std::make_unique<archive_file>(fileName));
+
+		// archives are inputs even when none of their members are needed, as changing them could change that
+
+		mInputFiles.push_back(fileName);
+
+		for (auto& sym : archive.archive.symbols())
+		{
+			std::string name(sym.name);
+			std::replace(name.begin(), name.end(), '.', '_');
+
+			providers.emplace(std::move(name), member_ref { static_cast<unsigned>(archives.size() - 1), sym.memberOffset });
+		}
+	}
+
+	// names referred to are queued in the order they are found, and looked up once each
+	// members are only scanned for what they define and refer to once they are appended
+
+	std::unordered_set<std::string> defined;
+	std::unordered_set<std::string> referred;
+	std::vector<std::string> queue;
+
+	std::size_t scannedSections = 0;
+	std::size_t scannedAbsolutes = 0;
+
+	auto scanNew = [&] ()
+	{
+		for (; scannedAbsolutes < mAbsoluteSymbols.size(); ++scannedAbsolutes)
+			if (!mAbsoluteSymbols[scannedAbsolutes].name.is_local_key())
+				defined.emplace(mAbsoluteSymbols[scannedAbsolutes].name.text());
+
+		for (; scannedSections < mSections.size(); ++scannedSections)
+		{
+			const auto& section = mSections[scannedSections];
+
+			for (unsigned i = 0; i < section.symbols().size(); ++i)
+				if (!section.symbols().is_local(i))
+					defined.emplace(section.symbol_name(i).text());
+
+			for (unsigned i = 0; i < section.relocations().size(); ++i)
+			{
+				symbol_ref ref = section.relocation_symbol(i);
+
+				if (!ref.is_local_key() && referred.emplace(ref.text()).second)
+					queue.emplace_back(ref.text());
+			}
+		}
+	};
+
+	std::unordered_set<std::uint64_t> extracted;
+
+	scanNew();
+
+	// the queue only grows when a member is appended, so once it is through nothing else can be needed
+
+	for (std::size_t next = 0; next < queue.size(); ++next)
+	{
+		// (absolute symbols of objects are in defined already, so this only has to look in the databases)
+
+		if (defined.count(queue[next]) || find_absolute_symbol({}, queue[next]))
+			continue;
+
+		auto it = providers.find(queue[next]);
+
+		if (it == providers.end())
+			continue;
+
+		auto& archive = *archives[it->second.archive];
+
+		if (!extracted.insert((std::uint64_t(it->second.archive) << 32) | it->second.offset).second)
+			continue;
+
+		auto member = archive.archive.member_at(it->second.offset);
+
+		append_from_elf(std::format("{0}({1})", archive.file.file_name(), member.name), member.data);
+		scanNew();
+	}
+}
+
+void event_object::append_from_symbol_list(const char* fileName)
+{
+	const mapped_file file(fileName);
+	const auto entries = parse_symbol_list(fileName, std::string_view(reinterpret_cast<const char*>(file.data()), file.size()));
+
+	mInputFiles.push_back(fileName);
+
+	mAbsoluteSymbols.reserve(mAbsoluteSymbols.size() + entries.size());
+
+	// names get their dots replaced, as they are when loading objects
+
+	std::string nameBuffer;
+
+	for (auto& entry : entries)
+	{
+		std::string_view name = entry.name;
+
+		if (name.find('.') != std::string_view::npos)
+		{
+			nameBuffer.assign(name);
+			std::replace(nameBuffer.begin(), nameBuffer.end(), '.', '_');
+
+			name = nameBuffer;
+		}
+
+		mAbsoluteSymbols.push_back(absolute_symbol {
+			mAbsoluteNames.get(mAbsoluteNames.add(name)),
+			entry.address,
+			entry.size,
+			entry.isFunction,
+		});
+	}
+}
+
+/* layout of prepared objects (after the magic and version, see lyn::prepared_writer):
+ *   section count, absolute symbol count, size of absolute symbol names
+ *   absolute symbols: u64 keys[] (0 for named ones), u32 offsets[], u32 sizes[], u8 flags[], u32 nameSizes[], char names[]
+ *   for each section:
+ *     name size, placed (0 or 1), address, data size, string count, size of strings, relocation count, symbol count, mapping count
+ *     char name[], u8 data[], u32 stringSizes[], char strings[]
+ *     relocations: u32 offsets[], u32 types[], i32 addends[], u64 symbols[]
+ *     symbols: u64 names[], u32 offsets[], u32 sizes[], u8 flags[]
+ *     mappings: u32 offsets[], u32 types[]
+ * names in relocation and symbol tables are as in section_data: string ids in the section's strings or local keys
+ * local keys are relative to the prepared object (as if its tables were the first ones) */
+
+namespace {
+
+constexpr std::uint8_t PREPARED_FUNCTION = 1 << 0;
+
+// the smallest a section can take in a prepared object (its 9 header words), to check counts before reserving for them
+
+constexpr std::size_t PREPARED_SECTION_MIN_SIZE = 9 * 4;
+
+} // namespace
+
+void event_object::append_from_prepared(const char* fileName)
+{
+	const mapped_file file(fileName);
+	append_from_prepared(fileName, file.bytes());
+
+	mInputFiles.push_back(fileName);
+}
+
+void event_object::append_from_prepared(std::string_view name, std::span<const std::uint8_t> data)
+{
+	prepared_reader reader(name, data);
+
+	// locals were keyed as if the object's tables were the first ones, so they are moved after the tables already there
+	// (this keeps the keys they would have had if the object itself had been appended here)
+
+	const unsigned tableBase = mSections.size();
+	const std::uint64_t keyBase = static_cast<std::uint64_t>(tableBase) << 32;
+
+	const unsigned sectionCount = reader.word();
+	const unsigned absoluteCount = reader.word();
+	const unsigned absoluteNamesSize = reader.word();
+
+	if (sectionCount > data.size() / PREPARED_SECTION_MIN_SIZE)
+		reader.fail("damaged prepared object");
+
+	// absolute symbols, which are only added once the whole object has been read
+
+	std::vector<std::uint64_t> absoluteKeys;
+	std::vector<unsigned> absoluteOffsets;
+	std::vector<unsigned> absoluteSizes;
+	std::vector<std::uint8_t> absoluteFlags;
+	std::vector<unsigned> absoluteNameSizes;
+
+	reader.array<std::uint64_t>(absoluteKeys, absoluteCount);
+	reader.array<std::uint32_t>(absoluteOffsets, absoluteCount);
+	reader.array<std::uint32_t>(absoluteSizes, absoluteCount);
+	reader.array<std::uint8_t>(absoluteFlags, absoluteCount);
+	reader.array<std::uint32_t>(absoluteNameSizes, absoluteCount);
+
+	std::string_view absoluteNames = reader.chars(absoluteNamesSize);
+
+	if (std::accumulate(absoluteNameSizes.begin(), absoluteNameSizes.end(), std::uint64_t(0)) != absoluteNamesSize)
+		reader.fail("damaged prepared object");
+
+	// sections, which are built in the arena as they are when loading objects
+
+	std::pmr::vector<section_data> newSections(&mArena);
+	newSections.reserve(sectionCount);
+
+	std::vector<unsigned> stringSizes;
+	std::vector<std::uint32_t> mappingWords[2];
+	std::vector<section_data::mapping> mappings;
+
+	for (unsigned si = 0; si < sectionCount; ++si)
+	{
+		auto& section = newSections.emplace_back();
+
+		const unsigned nameSize = reader.word();
+		const unsigned isPlaced = reader.word();
+		const unsigned address = reader.word();
+		const unsigned dataSize = reader.word();
+		const unsigned stringCount = reader.word();
+		const unsigned stringsSize = reader.word();
+		const unsigned relocationCount = reader.word();
+		const unsigned symbolCount = reader.word();
+		const unsigned mappingCount = reader.word();
+
+		section.set_name(reader.chars(nameSize));
+
+		if (isPlaced)
+			section.set_address(address);
+
+		reader.array<std::uint8_t>(section, dataSize);
+
+		reader.array<std::uint32_t>(stringSizes, stringCount);
+		std::string_view strings = reader.chars(stringsSize);
+
+		section.names().reserve(stringCount, stringsSize);
+
+		for (unsigned size : stringSizes)
+		{
+			if (size > strings.size())
+				reader.fail("damaged prepared object");
+
+			section.names().add(strings.substr(0, size));
+			strings.remove_prefix(size);
+		}
+
+		auto& relocations = section.relocations();
+
+		reader.array<std::uint32_t>(relocations.offsets, relocationCount);
+		reader.array<std::uint32_t>(relocations.types, relocationCount);
+		reader.array<std::int32_t>(relocations.addends, relocationCount);
+		reader.array<std::uint64_t>(relocations.symbols, relocationCount);
+
+		auto& symbols = section.symbols();
+
+		reader.array<std::uint64_t>(symbols.names, symbolCount);
+		reader.array<std::uint32_t>(symbols.offsets, symbolCount);
+		reader.array<std::uint32_t>(symbols.sizes, symbolCount);
+		reader.array<std::uint8_t>(symbols.flags, symbolCount);
+
+		// names are checked here, as sections trust their ids
+
+		auto rebaseNames = [&] (std::pmr::vector<section_data::name_id>& ids)
+		{
+			for (auto& id : ids)
+			{
+				if (id >> 32)
+					id += keyBase;
+				else if (id >= stringCount)
+					reader.fail("damaged prepared object");
+			}
+		};
+
+		rebaseNames(relocations.symbols);
+		rebaseNames(symbols.names);
+
+		reader.array<std::uint32_t>(mappingWords[0], mappingCount);
+		reader.array<std::uint32_t>(mappingWords[1], mappingCount);
+
+		if (mappingCount != 0)
+		{
+			mappings.clear();
+
+			for (unsigned i = 0; i < mappingCount; ++i)
+			{
+				if (mappingWords[1][i] > section_data::mapping::ARM)
+					reader.fail("damaged prepared object");
+
+				mappings.push_back({ static_cast<section_data::mapping::type_enum>(mappingWords[1][i]), mappingWords[0][i] });
+			}
+
+			section.set_mappings(std::move(mappings));
+		}
+	}
+
+	if (!reader.at_end())
+		reader.fail("damaged prepared object");
+
+	mAbsoluteSymbols.reserve(mAbsoluteSymbols.size() + absoluteCount);
+
+	for (unsigned i = 0; i < absoluteCount; ++i)
+	{
+		const std::uint64_t key = absoluteKeys[i];
+
+		symbol_ref symName = (key != 0)
+			? symbol_ref::local((key >> 32) - 1 + tableBase, key & 0xFFFFFFFF)
+			: symbol_ref(mAbsoluteNames.get(mAbsoluteNames.add(absoluteNames.substr(0, absoluteNameSizes[i]))));
+
+		absoluteNames.remove_prefix(absoluteNameSizes[i]);
+
+		mAbsoluteSymbols.push_back(absolute_symbol {
+			symName,
+			absoluteOffsets[i],
+			absoluteSizes[i],
+			(absoluteFlags[i] & PREPARED_FUNCTION) != 0,
+		});
+	}
+
+	mSections.insert(mSections.end(),
+		std::make_move_iterator(newSections.begin()),
+		std::make_move_iterator(newSections.end()));
+}
+
+void event_object::write_prepared(const std::string& fileName) const
+{
+	make_prepared(0, 0).write(fileName);
+}
+
+prepared_writer event_object::make_prepared(std::size_t sectionBegin, std::size_t absoluteBegin) const
+{
+	// locals are keyed relative to the first section written, which is undone by append_from_prepared
+
+	const std::uint64_t keyBase = static_cast<std::uint64_t>(sectionBegin) << 32;
+
+	const auto sections = std::span(mSections).subspan(sectionBegin);
+	const auto absolutes = std::span(mAbsoluteSymbols).subspan(absoluteBegin);
+
+	prepared_writer writer;
+
+	writer.put_word(sections.size());
+	writer.put_word(absolutes.size());
+
+	{
+		std::vector<std::uint64_t> keys;
+		std::vector<unsigned> offsets;
+		std::vector<unsigned> sizes;
+		std::vector<std::uint8_t> flags;
+		std::vector<unsigned> nameSizes;
+		std::string names;
+
+		for (auto& sym : absolutes)
+		{
+			keys.push_back(sym.name.is_local_key() ? sym.name.local_key() - keyBase : 0);
+			offsets.push_back(sym.offset);
+			sizes.push_back(sym.size);
+			flags.push_back(sym.is_function ? PREPARED_FUNCTION : 0);
+			nameSizes.push_back(sym.name.text().size());
+
+			names.append(sym.name.text());
+		}
+
+		writer.put_word(names.size());
+
+		writer.put_array<std::uint64_t>(keys);
+		writer.put_array<std::uint32_t>(offsets);
+		writer.put_array<std::uint32_t>(sizes);
+		writer.put_array<std::uint8_t>(flags);
+		writer.put_array<std::uint32_t>(nameSizes);
+		writer.put_chars(names);
+	}
+
+	std::vector<unsigned> stringSizes;
+	std::string strings;
+	std::vector<std::uint32_t> mappingWords[2];
+	std::vector<section_data::name_id> nameIds;
+
+	auto putNameIds = [&] (const std::pmr::vector<section_data::name_id>& ids)
+	{
+		if (keyBase == 0)
+		{
+			writer.put_array<std::uint64_t>(ids);
+			return;
+		}
+
+		nameIds.assign(ids.begin(), ids.end());
+
+		for (auto& id : nameIds)
+			if (id >> 32)
+				id -= keyBase;
+
+		writer.put_array<std::uint64_t>(nameIds);
+	};
+
+	for (auto& section : sections)
+	{
+		stringSizes.clear();
+		strings.clear();
+
+		for (unsigned i = 0; i < section.names().size(); ++i)
+		{
+			stringSizes.push_back(section.names().get(i).size());
+			strings.append(section.names().get(i));
+		}
+
+		mappingWords[0].clear();
+		mappingWords[1].clear();
+
+		for (auto& mapping : section.mappings())
+		{
+			mappingWords[0].push_back(mapping.offset);
+			mappingWords[1].push_back(mapping.type);
+		}
+
+		writer.put_word(section.name().size());
+		writer.put_word(section.is_placed() ? 1 : 0);
+		writer.put_word(section.is_placed() ? section.address() : 0);
+		writer.put_word(section.size());
+		writer.put_word(stringSizes.size());
+		writer.put_word(strings.size());
+		writer.put_word(section.relocations().size());
+		writer.put_word(section.symbols().size());
+		writer.put_word(section.mappings().size());
+
+		writer.put_chars(section.name());
+		writer.put_array<std::uint8_t>(section);
+
+		writer.put_array<std::uint32_t>(stringSizes);
+		writer.put_chars(strings);
+
+		auto& relocations = section.relocations();
+
+		writer.put_array<std::uint32_t>(relocations.offsets);
+		writer.put_array<std::uint32_t>(relocations.types);
+		writer.put_array<std::int32_t>(relocations.addends);
+		putNameIds(relocations.symbols);
+
+		auto& symbols = section.symbols();
+
+		putNameIds(symbols.names);
+		writer.put_array<std::uint32_t>(symbols.offsets);
+		writer.put_array<std::uint32_t>(symbols.sizes);
+		writer.put_array<std::uint8_t>(symbols.flags);
+
+		writer.put_array<std::uint32_t>(mappingWords[0]);
+		writer.put_array<std::uint32_t>(mappingWords[1]);
+	}
+
+	return writer;
+}
 
-					bool is_function = sym.get_st_type() == elfcpp::STT_FUNC;
+void event_object::add_symbol_db(const std::string& fileName)
+{
+	mSymbolDbs.push_back(std::make_unique<symbol_db>(fileName));
+	mInputFiles.push_back(fileName);
+}
 
-					mAbsoluteSymbols.push_back(section_data::symbol {
-						name,
-						sym.get_st_value(),
-						false,
-						is_function,
-					});
+void event_object::apply_layout(const layout_profile& profile, std::ostream* report) {
+	enum layout_class { Hot, Normal, Cold };
 
-					break;
-				} // case elfcpp::SHN_ABS
+	struct layout_entry {
+		section_data* section;
+		layout_class cls;
+		unsigned long long weight;
+	};
 
-				default:
-				{
-					if (sym.get_st_shndx() >= outMap.size())
-						break;
+	static const char* const classNames[] = { "hot", "normal", "cold" };
 
-					if (!outMap.at(sym.get_st_shndx()))
-						break;
+	std::vector<layout_entry> entries;
+	entries.reserve(mSections.size());
 
-					auto& section = newSections.at(sym.get_st_shndx());
+	for (auto& section : mSections) {
+		unsigned long long weight = 0;
 
-					std::string name = readString(nameShdr, sym.get_st_name());
+		for (unsigned i = 0; i < section.symbols().size(); ++i)
+			if (auto name = section.symbol_name(i); !name.is_local_key())
+				weight += profile.weight(name.text());
 
-					if (sym.get_st_type() == elfcpp::STT_NOTYPE && sym.get_st_bind() == elfcpp::STB_LOCAL)
-					{
-						std::string subString = name.substr(0, 3);
+		// the compiler already split functions into hot and cold parts for us
+		// we just need to keep these parts together across objects
 
-						if ((name == "$t") || (subString == "$t."))
-						{
-							// section.set_mapping(sym.get_st_value(), section_data::mapping::Thumb);
-							break;
-						}
+		std::string_view name = section.name();
 
-						if ((name == "$a") || (subString == "$a."))
-						{
-							// section.set_mapping(sym.get_st_value(), section_data::mapping::ARM);
-							break;
-						}
+		layout_class cls = Normal;
 
-						if ((name == "$d") || (subString == "$d."))
-						{
-							// section.set_mapping(sym.get_st_value(), section_data::mapping::Data);
-							break;
-						}
-					}
+		if (name.starts_with(".text.unlikely") || name.starts_with(".text.cold"))
+			cls = Cold;
+		else if (weight != 0 || name.starts_with(".text.hot"))
+			cls = Hot;
 
-					if (sym.get_st_bind() == elfcpp::STB_LOCAL)
-						name = getLocalSymbolName(si, i);
-					else
-						name = getGlobalSymbolName(name.c_str());
+		entries.push_back({ &section, cls, weight });
+	}
 
-					bool is_local = sym.get_st_bind() == elfcpp::STB_LOCAL;
-					bool is_function = sym.get_st_type() == elfcpp::STT_FUNC;
+	// hot sections are clustered by decreasing weight, everything else keeps object order
 
-					section.symbols().push_back(section_data::symbol {
-						name,
-						sym.get_st_value(),
-						is_local,
-						is_function,
-					});
+	std::stable_sort(entries.begin(), entries.end(),
+		[] (const layout_entry& a, const layout_entry& b) -> bool {
+			if (a.cls != b.cls)
+				return a.cls < b.cls;
 
-					break;
-				} // default
+			return (a.cls == Hot) && (a.weight > b.weight);
+		}
+	);
 
-				} // switch (sym.get_st_shndx())
-			}
+	if (report) {
+		*report << "# lyn layout report" << std::endl;
+		*report << "# offset size     class  weight               section" << std::endl;
 
-			break;
-		} // case elfcpp::SHT_SYMTAB
+		unsigned offset = 0;
 
-		case elfcpp::SHT_REL:
-		{
-			if (!outMap.at(header.get_sh_info()))
-				break;
+		for (auto& entry : entries) {
+			*report << std::format("${0:06X}  ${1:06X}  {2:<6} {3:<20} {4}",
+				offset, entry.section->size(), classNames[entry.cls], entry.weight, entry.section->name());
 
-			const unsigned count = header.get_sh_size() / header.get_sh_entsize();
+			for (unsigned i = 0; i < entry.section->symbols().size(); ++i)
+				if (!entry.section->symbols().is_local(i))
+					*report << " " << entry.section->symbol_name(i);
 
-			const elfcpp::Shdr<32, false> symShdr(&file, elfFile.section_header(header.get_sh_link()));
-			const elfcpp::Shdr<32, false> symNameShdr(&file, elfFile.section_header(symShdr.get_sh_link()));
+			*report << std::endl;
 
-			auto& section = newSections.at(header.get_sh_info());
+			offset += entry.section->size();
 
-			for (unsigned i = 0; i < count; ++i)
-			{
-				const elfcpp::Rel<32, false> rel(&file, data_file::Location(
-					header.get_sh_offset() + i * header.get_sh_entsize(),
-					header.get_sh_entsize()
-				));
-
-				const elfcpp::Sym<32, false> sym(&file, data_file::Location(
-					symShdr.get_sh_offset() + elfcpp::elf_r_sym<32>(rel.get_r_info()) * symShdr.get_sh_entsize(),
-					symShdr.get_sh_entsize()
-				));
-
-				const std::string name = (sym.get_st_bind() == elfcpp::STB_LOCAL)
-					? getLocalSymbolName(header.get_sh_link(), elfcpp::elf_r_sym<32>(rel.get_r_info()))
-					: getGlobalSymbolName(readString(symNameShdr, sym.get_st_name()).c_str());
-
-				section.relocations().push_back(section_data::relocation {
-					name,
-					0,
-					elfcpp::elf_r_type<32>(rel.get_r_info()),
-					rel.get_r_offset()
-				});
-			}
+			if (unsigned misalign = (offset % 4))
+				offset += (4 - misalign);
+		}
+	}
 
-			break;
-		} // case elfcpp::SHT_REL
+	std::pmr::vector<section_data> newSections(&mArena);
+	newSections.reserve(mSections.size());
 
-		case elfcpp::SHT_RELA:
-		{
-			if (!outMap.at(header.get_sh_info()))
-				break;
+	for (auto& entry : entries)
+		newSections.push_back(std::move(*entry.section));
 
-			const unsigned count = header.get_sh_size() / header.get_sh_entsize();
+	mSections = std::move(newSections);
+}
 
-			const elfcpp::Shdr<32, false> symShdr(&file, elfFile.section_header(header.get_sh_link()));
-			const elfcpp::Shdr<32, false> symNameShdr(&file, elfFile.section_header(symShdr.get_sh_link()));
+void event_object::allocate_regions(region_allocator& allocator, std::ostream* report) {
+	std::vector<section_data*> order;
+	order.reserve(mSections.size());
 
-			auto& section = newSections.at(header.get_sh_info());
+	for (auto& section : mSections)
+		if (!section.is_placed() && section.size() != 0)
+			order.push_back(&section);
 
-			for (unsigned i = 0; i < count; ++i)
-			{
-				const elfcpp::Rela<32, false> rela(&file, data_file::Location(
-					header.get_sh_offset() + i * header.get_sh_entsize(),
-					header.get_sh_entsize()
-				));
-
-				const elfcpp::Sym<32, false> sym(&file, data_file::Location(
-					symShdr.get_sh_offset() + elfcpp::elf_r_sym<32>(rela.get_r_info()) * symShdr.get_sh_entsize(),
-					symShdr.get_sh_entsize()
-				));
-
-				const std::string name = (sym.get_st_bind() == elfcpp::STB_LOCAL)
-					? getLocalSymbolName(header.get_sh_link(), elfcpp::elf_r_sym<32>(rela.get_r_info()))
-					: getGlobalSymbolName(readString(symNameShdr, sym.get_st_name()).c_str());
-
-				section.relocations().push_back(section_data::relocation {
-					name,
-					rela.get_r_addend(),
-					elfcpp::elf_r_type<32>(rela.get_r_info()),
-					rela.get_r_offset()
-				});
-			}
+	// best fit decreasing: big sections first, while there's still room for them
 
-			break;
-		} // case elfcpp::SHT_RELA
+	std::stable_sort(order.begin(), order.end(),
+		[] (const section_data* a, const section_data* b) -> bool {
+			return a->size() > b->size();
+		}
+	);
 
-		} // switch (header.get_sh_type())
-	}
+	for (auto section : order)
+		if (auto address = allocator.allocate(section->size()))
+			section->set_address(*address);
 
-	// Remove empty sections
+	if (report) {
+		allocator.write_report(*report);
 
-	newSections.erase(std::remove_if(newSections.begin(), newSections.end(),
-		[] (const section_data& section)
-		{
-			return (section.size()==0);
-		}
-	), newSections.end());
+		*report << "# lyn placement report" << std::endl;
 
-	// Add to existing section list
+		for (auto& section : mSections) {
+			if (section.is_placed())
+				*report << std::format("${0:06X}  ${1:06X}  {2}", section.address(), section.size(), section.name());
+			else
+				*report << std::format("stream   ${0:06X}  {1}", section.size(), section.name());
 
-	mSections.reserve(mSections.size() + newSections.size());
+			for (unsigned i = 0; i < section.symbols().size(); ++i)
+				if (!section.symbols().is_local(i))
+					*report << " " << section.symbol_name(i);
 
-	std::copy(
-		std::make_move_iterator(newSections.begin()),
-		std::make_move_iterator(newSections.end()),
-		std::back_inserter(mSections)
-	);
+			*report << std::endl;
+		}
+	}
 }
 
 void event_object::try_transform_relatives() {
-	for (auto& section : mSections) {
-		for (auto& relocation : section.relocations()) {
-			if (auto relocatelet = mRelocator.get_relocatelet(relocation.type)) {
-				if (!relocatelet->is_absolute() && relocatelet->can_make_trampoline()) {
+	// trampolines are appended as sections, so we iterate by index
+
+	const std::size_t sectionCount = mSections.size();
+
+	for (std::size_t si = 0; si < sectionCount; ++si) {
+		for (std::size_t i = 0; i < mSections[si].relocations().size(); ++i) {
+			if (auto descriptor = arm_relocator::get_descriptor(mSections[si].relocations().types[i])) {
+				if (!descriptor->is_absolute() && descriptor->can_make_trampoline()) {
+					symbol_ref symbolName = mSections[si].relocation_symbol(i);
+					std::string targetName = symbolName.str();
+					int addend = mSections[si].relocations().addends[i];
 					std::string renamed;
 
-					renamed.reserve(4 + relocation.symbolName.size());
+					renamed.reserve(4 + targetName.size());
 
 					renamed.append("_LP_"); // local proxy
-					renamed.append(relocation.symbolName);
+
+					// relocations to placed sections can refer to a literal address, which isn't a valid label name
+
+					if (targetName.starts_with('$'))
+						renamed.append(targetName.substr(1));
+					else
+						renamed.append(targetName);
 
 					bool exists = false;
 
 					for (auto& section : mSections)
-						for (auto& sym : section.symbols())
-							if (sym.name == renamed)
+						for (unsigned j = 0; j < section.symbols().size(); ++j)
+							if (section.symbol_name(j) == symbol_ref(renamed))
 								exists = true;
 
 					if (!exists) {
-						section_data newData = relocatelet->make_trampoline(relocation.symbolName, relocation.addend);
-						newData.symbols().push_back({ renamed, (newData.mapping_type_at(0) == section_data::mapping::Thumb), true });
+						section_data newData = descriptor->make_trampoline(symbolName, addend);
+						newData.add_symbol(renamed, (newData.mapping_type_at(0) == section_data::mapping::Thumb), newData.size(), true, false);
 
 						mSections.push_back(std::move(newData));
 					}
 
-					relocation.symbolName = renamed;
-					relocation.addend = 0; // TODO: -4
+					// mSections may have moved
+
+					mSections[si].set_relocation_symbol(i, renamed);
+					mSections[si].relocations().addends[i] = 0; // TODO: -4
 				}
 			}
 		}
@@ -329,163 +1102,307 @@ void event_object::try_transform_relatives() {
 }
 
 void event_object::try_relocate_relatives() {
-	unsigned offset = 0;
+	auto offsets = section_offsets();
 
-	for (auto& section : mSections) {
-		section.relocations().erase(
-			std::remove_if(
-				section.relocations().begin(),
-				section.relocations().end(),
-				[this, &section, offset] (section_data::relocation& relocation) -> bool {
-					unsigned symOffset = 0;
-
-					auto relocatelet = mRelocator.get_relocatelet(relocation.type);
-
-					for (auto& symSection : mSections) {
-						for (auto& symbol : symSection.symbols()) {
-							if (symbol.name != relocation.symbolName)
-								continue;
-
-							if (relocatelet && !relocatelet->is_absolute()) {
-								relocatelet->apply_relocation(
-									section,
-									relocation.offset,
-									symOffset + symbol.offset,
-									relocation.addend
-								);
-
-								return true;
-							}
-
-							relocation.symbolName = "CURRENTOFFSET";
-							relocation.addend += (symOffset + symbol.offset) - (offset + relocation.offset);
-
-							return false;
-						}
+	// first definition of each name wins
+
+	struct symbol_location {
+		unsigned sectionIndex;
+		unsigned symbolIndex;
+	};
 
-						symOffset += symSection.size();
+	// names are views into the section string pools, which don't move
 
-						if (unsigned misalign = (symOffset % 4))
-							symOffset += (4 - misalign);
-					}
+	std::unordered_map<symbol_ref, symbol_location, symbol_ref::hash> symbolMap;
+
+	for (unsigned i = 0; i < mSections.size(); ++i)
+		for (unsigned j = 0; j < mSections[i].symbols().size(); ++j)
+			symbolMap.insert({ mSections[i].symbol_name(j), { i, j } });
+
+	std::vector<resolved_relocation> resolved;
+
+	for (unsigned i = 0; i < mSections.size(); ++i) {
+		auto& section = mSections[i];
+		auto& relocations = section.relocations();
+		unsigned offset = offsets[i];
+
+		relocations.erase_if([this, &section, &relocations, &offsets, &symbolMap, &resolved, offset] (std::size_t index) -> bool {
+			auto it = symbolMap.find(section.relocation_symbol(index));
 
-					return false;
+			if (it == symbolMap.end())
+				return false;
+
+			auto& symSection = mSections[it->second.sectionIndex];
+			unsigned symIndex = it->second.symbolIndex;
+
+			unsigned symOffset = offsets[it->second.sectionIndex] + symSection.symbols().offsets[symIndex];
+
+			// the distance between a placed and a streamed section is only known by EA
+			// so we refer to placed symbols by address, and make sure streamed ones are visible
+
+			if (symSection.is_placed() != section.is_placed()) {
+				if (symSection.is_placed()) {
+					section.set_relocation_symbol(index, std::format("${0:X}", symOffset));
+				} else {
+					symSection.symbols().flags[symIndex] &= ~section_data::symbol_table::Local;
 				}
-			),
-			section.relocations().end()
-		);
 
-		offset += section.size();
+				return false;
+			}
 
-		if (unsigned misalign = (offset % 4))
-			offset += (4 - misalign);
+			unsigned type = relocations.types[index];
+			auto descriptor = arm_relocator::get_descriptor(type);
+
+			if (descriptor && !descriptor->is_absolute()) {
+				resolved.push_back({ relocations.offsets[index], type, symOffset - offset, relocations.addends[index] });
+				return true;
+			}
+
+			section.set_relocation_symbol(index, "CURRENTOFFSET");
+			relocations.addends[index] += symOffset - (offset + relocations.offsets[index]);
+
+			return false;
+		});
+
+		apply_resolved_relocations(section, resolved);
 	}
 }
 
 void event_object::try_relocate_absolutes() {
 	auto absolute_ids = make_absolute_symbol_map();
+	erase_defined_symbols(absolute_ids);
+
+	std::vector<resolved_relocation> resolved;
 
 	for (auto& section : mSections) {
-		section.relocations().erase(
-			std::remove_if(
-				section.relocations().begin(),
-				section.relocations().end(),
-				[this, &section, &absolute_ids] (const section_data::relocation& relocation) -> bool {
-					auto it = absolute_ids.find(relocation.symbolName);
-
-					if (it != absolute_ids.end()) {
-						auto & symbol = mAbsoluteSymbols[it->second];
-
-						if (auto relocatelet = mRelocator.get_relocatelet(relocation.type)) {
-							if (relocatelet->is_absolute()) {
-								relocatelet->apply_relocation(
-									section,
-									relocation.offset,
-									symbol.offset,
-									relocation.addend
-								);
-
-								return true;
-							}
-						}
+		auto& relocations = section.relocations();
 
-						return false;
-					}
+		relocations.erase_if([this, &section, &relocations, &absolute_ids, &resolved] (std::size_t index) -> bool {
+			auto symbol = find_absolute_symbol(absolute_ids, section.relocation_symbol(index));
 
-					return false;
+			if (symbol) {
+				if (auto descriptor = arm_relocator::get_descriptor(relocations.types[index])) {
+					if (descriptor->is_absolute()) {
+						resolved.push_back({ relocations.offsets[index], relocations.types[index], symbol->offset, relocations.addends[index] });
+						return true;
+					}
 				}
-			),
-			section.relocations().end()
-		);
+
+				return false;
+			}
+
+			return false;
+		});
+
+		apply_resolved_relocations(section, resolved);
 	}
 }
 
 void event_object::remove_unnecessary_symbols() {
+	// names any relocation is dependant on, gathered once rather than per symbol
+
+	std::unordered_set<symbol_ref, symbol_ref::hash> referenced;
+
+	for (auto& section : mSections)
+		for (std::size_t i = 0; i < section.relocations().size(); ++i)
+			referenced.insert(section.relocation_symbol(i));
+
 	for (auto& section : mSections) {
-		section.symbols().erase(
-			std::remove_if(
-				section.symbols().begin(),
-				section.symbols().end(),
-				[this] (const section_data::symbol& symbol) -> bool {
-					if (!symbol.is_local)
-						return false; // symbol may be used outside of the scope of this object
+		section.symbols().erase_if([&section, &referenced] (std::size_t index) -> bool {
+			if (!section.symbols().is_local(index))
+				return false; // symbol may be used outside of the scope of this object
 
-					for (auto& section : mSections)
-						for (auto& reloc : section.relocations())
-							if (reloc.symbolName == symbol.name)
-								return false; // a relocation is dependant on this symbol
+			if (referenced.count(section.symbol_name(index)))
+				return false; // a relocation is dependant on this symbol
 
-					return true; // symbol is local and unused, we can remove it safely (hopefully)
-				}
-			),
-			section.symbols().end()
-		);
+			return true; // symbol is local and unused, we can remove it safely (hopefully)
+		});
 	}
 }
 
 void event_object::cleanup() {
 	for (auto& section : mSections) {
-		std::sort(
-			section.symbols().begin(),
-			section.symbols().end(),
-			[] (const section_data::symbol& a, const section_data::symbol& b) -> bool {
-				return a.offset < b.offset;
-			}
-		);
+		// this is the order write_section_data_event needs
+
+		section.relocations().stable_sort_by_offset();
+		section.symbols().stable_sort_by_offset();
+	}
+}
+
+void event_object::place_replacements() {
+	auto absolute_ids = make_absolute_symbol_map();
+
+	for (auto& section : mSections) {
+		if (section.is_placed())
+			continue;
+
+		auto& symbols = section.symbols();
+
+		for (std::size_t i = 0; i < symbols.size(); ++i) {
+			if (symbols.is_local(i) || (symbols.offsets[i] & ~1) != 0)
+				continue;
+
+			auto absSymbol = find_absolute_symbol(absolute_ids, section.symbol_name(i));
+
+			if (!absSymbol)
+				continue;
+
+			unsigned address = absSymbol->offset & ~1;
+
+			// the replacement has to fit in the original footprint
+			// and the original has to be aligned enough for any literal pool it may have
+
+			if (!absSymbol->is_function || address < 0x08000000 || address >= 0x0A000000)
+				continue;
+
+			if ((address % 4) != 0 || section.size() > absSymbol->size)
+				continue;
+
+			// calls to the original are made in its instruction set, which the replacement has to be in as well
+			// (otherwise the veneer of the hook is what switches between them)
+
+			const int mapping = section.mapping_type_at(0);
+
+			const bool isReplacementThumb = (symbols.offsets[i] & 1) != 0 || mapping == section_data::mapping::Thumb;
+			const bool isReplacementArm = !isReplacementThumb && mapping == section_data::mapping::ARM;
+
+			if ((absSymbol->offset & 1) ? !isReplacementThumb : !isReplacementArm)
+				continue;
+
+			section.set_address(address - 0x08000000);
+			break;
+		}
+	}
+}
+
+std::vector<branch_index::code_range> event_object::rom_functions() const {
+	std::vector<branch_index::code_range> result;
+
+	auto addFunction = [&result] (unsigned address, unsigned size, bool isFunction) {
+		// (functions without a size could be anything past their start)
+
+		if (!isFunction || size == 0 || address < 0x08000000 || address >= 0x0A000000)
+			return;
+
+		const unsigned begin = (address & ~1) - 0x08000000;
+		result.push_back({ begin, begin + size, (address & 1) != 0 });
+	};
+
+	for (auto& absSymbol : mAbsoluteSymbols)
+		addFunction(absSymbol.offset, absSymbol.size, absSymbol.is_function);
+
+	for (auto& db : mSymbolDbs) {
+		for (std::size_t i = 0; i < db->size(); ++i) {
+			auto entry = db->at(i);
+			addFunction(entry.address, entry.size, entry.isFunction);
+		}
+	}
+
+	return result;
+}
+
+std::vector<branch_index::rom_range> event_object::placed_ranges() const {
+	std::vector<branch_index::rom_range> result;
+
+	for (auto& section : mSections) {
+		if (section.is_placed() && section.size() != 0)
+			result.emplace_back(section.address(), section.address() + section.size());
 	}
+
+	return result;
 }
 
 std::vector<event_object::hook> event_object::get_hooks() const {
 	std::vector<hook> result;
 
-	std::unordered_set<std::string_view> symbol_names;
+	std::unordered_map<symbol_ref, unsigned, symbol_ref::hash> symbol_addresses;
 
-	for (auto& section : mSections) {
-		for (auto& locSymbol : section.symbols()) {
-			if (!locSymbol.is_local && !locSymbol.name.empty()) {
-				std::string_view name(locSymbol.name);
-				symbol_names.insert(name);
+	auto offsets = section_offsets();
+
+	for (unsigned i = 0; i < mSections.size(); ++i) {
+		auto& symbols = mSections[i].symbols();
+
+		for (std::size_t j = 0; j < symbols.size(); ++j) {
+			symbol_ref name = mSections[i].symbol_name(j);
+
+			if (!symbols.is_local(j) && name != symbol_ref()) {
+				// streamed symbols get an invalid address, as their address isn't known yet
+
+				symbol_addresses[name] = mSections[i].is_placed()
+					? offsets[i] + symbols.offsets[j]
+					: ~0u;
 			}
 		}
 	}
 
+	auto addHook = [&result] (const absolute_symbol& absSymbol, unsigned address) {
+		if (absSymbol.offset < 0x08000000 || absSymbol.offset >= 0x0A000000) {
+			std::string message(std::format("attempting to replace `{0}`, which is not in ROM (reference address: 0x{1:08X})",
+				absSymbol.name.str(), absSymbol.offset));
+
+			throw std::runtime_error(message);
+		}
+
+		if (!absSymbol.is_function) {
+			std::string message(std::format("attempting to replace `{0}`, which is not a function",
+				absSymbol.name.str()));
+
+			throw std::runtime_error(message);
+		}
+
+		// replaced in place: no hook needed
+
+		if ((address & ~1) == ((absSymbol.offset & ~1) - 0x08000000))
+			return;
+
+		std::optional<unsigned> replacementOffset;
+
+		if (address != ~0u)
+			replacementOffset = address;
+
+		result.push_back({ (absSymbol.offset - 0x08000000), absSymbol.name.str(), replacementOffset });
+	};
+
 	for (auto& absSymbol : mAbsoluteSymbols) {
-		if (symbol_names.contains(std::string_view(absSymbol.name))) {
-			if (absSymbol.offset < 0x08000000 || absSymbol.offset >= 0x0A000000) {
-				std::string message(std::format("attempting to replace `{0}`, which is not in ROM (reference address: 0x{1:08X})",
-					absSymbol.name, absSymbol.offset));
+		auto it = symbol_addresses.find(absSymbol.name);
 
-				throw std::runtime_error(message);
-			}
+		if (it != symbol_addresses.end())
+			addHook(absSymbol, it->second);
+	}
+
+	// database symbols are looked up from the other side, as there are usually much fewer replacements than them
+	// (they are then sorted back in database order, so that the output doesn't depend on hashing)
 
-			if (!absSymbol.is_function) {
-				std::string message(std::format("attempting to replace `{0}`, which is not a function",
-					absSymbol.name));
+	if (!mSymbolDbs.empty()) {
+		auto absolute_ids = make_absolute_symbol_map();
 
-				throw std::runtime_error(message);
+		struct db_hook {
+			std::size_t db;
+			std::size_t index;
+			unsigned address;
+		};
+
+		std::vector<db_hook> dbHooks;
+
+		for (auto& [name, address] : symbol_addresses) {
+			if (absolute_ids.count(name) || name.is_local_key())
+				continue;
+
+			for (std::size_t i = 0; i < mSymbolDbs.size(); ++i) {
+				if (auto index = mSymbolDbs[i]->find(name.text())) {
+					dbHooks.push_back({ i, *index, address });
+					break;
+				}
 			}
+		}
 
-			result.push_back({ (absSymbol.offset - 0x08000000), absSymbol.name });
+		std::sort(dbHooks.begin(), dbHooks.end(), [] (const db_hook& a, const db_hook& b) {
+			return (a.db != b.db) ? (a.db < b.db) : (a.index < b.index);
+		});
+
+		for (auto& dbHook : dbHooks) {
+			auto entry = mSymbolDbs[dbHook.db]->at(dbHook.index);
+			addHook(absolute_symbol { entry.name, entry.address, entry.size, entry.isFunction }, dbHook.address);
 		}
 	}
 
@@ -493,124 +1410,178 @@ std::vector<event_object::hook> event_object::get_hooks() const {
 }
 
 void event_object::write_events(std::ostream& output) const {
-	unsigned offset = 0;
-
 	/* we do this here but this should really be something that have already */
 	auto abs_symbol_map = make_absolute_symbol_map();
+	erase_defined_symbols(abs_symbol_map);
 
-	for (auto& section : mSections) {
-		output << "ALIGN 4" << std::endl;
+	if (mSections.size() < 2 || !can_run_parallel()) {
+		for (auto& section : mSections)
+			write_section_events(output, section, abs_symbol_map);
 
-		if (std::any_of(
-			section.symbols().begin(),
-			section.symbols().end(),
+		return;
+	}
 
-			[] (const section_data::symbol& sym) {
-				return !sym.is_local;
-			}
-		)) {
-			output << "PUSH" << std::endl;
-			int currentOffset = 0;
+	// sections are written to text of their own in parallel, which is then output in order
 
-			for (auto& symbol : section.symbols()) {
-				if (symbol.is_local)
-					continue;
+	std::vector<std::string> texts(mSections.size());
+	std::vector<std::exception_ptr> errors(mSections.size());
 
-				output << "ORG CURRENTOFFSET+$" << std::hex << (symbol.offset - currentOffset) << ";"
-					   << symbol.name << ":" << std::endl;
-				currentOffset = symbol.offset;
-			}
+	parallel_for(mSections.size(), [&] (std::size_t i) {
+		try {
+			std::ostringstream text;
+			write_section_events(text, mSections[i], abs_symbol_map);
 
-			output << "POP" << std::endl;
+			texts[i] = std::move(text).str();
+		} catch (...) {
+			errors[i] = std::current_exception();
 		}
+	});
 
-		// TODO: this should never be true?
-		if (std::any_of(
-			section.symbols().begin(),
-			section.symbols().end(),
+	for (std::size_t i = 0; i < mSections.size(); ++i) {
+		if (errors[i])
+			std::rethrow_exception(errors[i]);
 
-			[] (const section_data::symbol& sym) {
-				return sym.is_local;
-			}
-		)) {
-			output << "{" << std::endl;
-			output << "PUSH" << std::endl;
+		output << texts[i];
+	}
+}
 
-			int currentOffset = 0;
+void event_object::write_section_events(std::ostream& output, const section_data& section, const absolute_symbol_map& abs_symbol_map) const {
+	if (section.is_placed())
+		output << "PUSH" << std::endl << "ORG $" << std::hex << section.address() << std::endl;
+	else
+		output << "ALIGN 4" << std::endl;
 
-			for (auto& symbol : section.symbols()) {
-				if (!symbol.is_local)
-					continue;
+	if (std::any_of(
+		section.symbols().flags.begin(),
+		section.symbols().flags.end(),
 
-				output << "ORG CURRENTOFFSET+$" << std::hex << (symbol.offset - currentOffset) << ";"
-					   << symbol.name << ":" << std::endl;
-				currentOffset = symbol.offset;
-			}
+		[] (std::uint8_t flags) {
+			return !(flags & section_data::symbol_table::Local);
+		}
+	)) {
+		output << "PUSH" << std::endl;
+		int currentOffset = 0;
 
-			output << "POP" << std::endl;
+		for (std::size_t i = 0; i < section.symbols().size(); ++i) {
+			if (section.symbols().is_local(i))
+				continue;
 
-			write_section_data_event(output, section, abs_symbol_map);
+			unsigned offset = section.symbols().offsets[i];
 
-			output << "}" << std::endl;
-		} else {
-			write_section_data_event(output, section, abs_symbol_map);
+			output << "ORG CURRENTOFFSET+$" << std::hex << (offset - currentOffset) << ";"
+				   << section.symbol_name(i) << ":" << std::endl;
+			currentOffset = offset;
 		}
 
-		offset += section.size();
+		output << "POP" << std::endl;
+	}
 
-		if (unsigned misalign = (offset % 4))
-			offset += (4 - misalign);
+	// TODO: this should never be true?
+	if (std::any_of(
+		section.symbols().flags.begin(),
+		section.symbols().flags.end(),
+
+		[] (std::uint8_t flags) {
+			return (flags & section_data::symbol_table::Local);
+		}
+	)) {
+		output << "{" << std::endl;
+		output << "PUSH" << std::endl;
+
+		int currentOffset = 0;
+
+		for (std::size_t i = 0; i < section.symbols().size(); ++i) {
+			if (!section.symbols().is_local(i))
+				continue;
+
+			unsigned offset = section.symbols().offsets[i];
+
+			output << "ORG CURRENTOFFSET+$" << std::hex << (offset - currentOffset) << ";"
+				   << section.symbol_name(i) << ":" << std::endl;
+			currentOffset = offset;
+		}
+
+		output << "POP" << std::endl;
+
+		write_section_data_event(output, section, abs_symbol_map);
+
+		output << "}" << std::endl;
+	} else {
+		write_section_data_event(output, section, abs_symbol_map);
 	}
+
+	if (section.is_placed())
+		output << "POP" << std::endl;
 }
 
 void event_object::write_section_data_event(
 	std::ostream& output,
 	const section_data& section,
-	const std::unordered_map<std::string_view, size_t>& abs_symbol_map) const
+	const absolute_symbol_map& abs_symbol_map) const
 {
 	constexpr size_t ALIGNMENT_MASK = 0b111; // 4, 2, 1
 
 	size_t prev_tail_offset = 0;
 
-	for (auto& relocation : section.relocations())
+	auto& relocations = section.relocations();
+
+	// event codes only live until they are written, so they all share one small scratch buffer
+
+	std::array<std::byte, 0x400> scratchBuffer;
+	std::pmr::monotonic_buffer_resource scratch(scratchBuffer.data(), scratchBuffer.size());
+
+	for (std::size_t i = 0; i < relocations.size(); ++i)
 	{
+		scratch.release();
+
+		unsigned offset = relocations.offsets[i];
+		unsigned type = relocations.types[i];
+		symbol_ref symbolName = section.relocation_symbol(i);
+
 		// write any bytes we skipped over
 
-		if (prev_tail_offset != relocation.offset)
+		if (offset < prev_tail_offset)
+		{
+			throw std::runtime_error(std::format("relocation at offset {0:X} in section `{1}` overlaps another or is out of order",
+				offset, section.name()));
+		}
+
+		if (prev_tail_offset != offset)
 		{
-			assert(prev_tail_offset < relocation.offset);
 
 			int alignment = prev_tail_offset & ALIGNMENT_MASK;
 
-			std::span<const unsigned char> bytes(
-				section.data() + prev_tail_offset,
-				relocation.offset - prev_tail_offset);
+			auto bytes = section.bytes(prev_tail_offset, offset - prev_tail_offset);
 
 			write_event_bytes(output, alignment, bytes);
 		}
 
 		// translate relocation into event
 
-		if (auto relocatelet = mRelocator.get_relocatelet(relocation.type))
+		if (auto descriptor = arm_relocator::get_descriptor(type))
 		{
 			// This is probably the worst hack I've ever written
 			// lyn needs a rewrite
 
 			// (I makes sure that relative relocations to known absolute values will reference the value and not the name)
 
-			auto it = abs_symbol_map.find(relocation.symbolName);
+			auto absSymbol = find_absolute_symbol(abs_symbol_map, symbolName);
+
+			std::pmr::string symName(&scratch);
 
-			auto symName = (it == abs_symbol_map.end())
-				? relocation.symbolName
-				: std::format("${0:X}", mAbsoluteSymbols[it->second].offset);
+			if (!absSymbol)
+				symbolName.append_to(symName);
+			else
+				std::format_to(std::back_inserter(symName), "${0:X}", absSymbol->offset);
 
-			event_code code(relocatelet->make_event_code(
+			event_code code(descriptor->make_event_code(
 				section,
-				relocation.offset,
+				offset,
 				symName,
-				relocation.addend));
+				relocations.addends[i],
+				&scratch));
 
-			int alignment = relocation.offset & ALIGNMENT_MASK;
+			int alignment = offset & ALIGNMENT_MASK;
 
 			if ((alignment % code.code_align()) == 0)
 				code.write_to_stream(output);
@@ -619,10 +1590,12 @@ void event_object::write_section_data_event(
 
 			output << std::endl;
 
-			prev_tail_offset = relocation.offset + code.code_size();
+			prev_tail_offset = offset + code.code_size();
 		}
-		else if (relocation.type != elfcpp::R_ARM_V4BX) // another dirty hack
-			throw std::runtime_error(std::format("unhandled relocation type #{0}", relocation.type));
+		else if (type == elfcpp::R_ARM_V4BX) // another dirty hack
+			prev_tail_offset = offset; // (the instruction is left as it is, and written with the bytes after it)
+		else
+			throw std::runtime_error(std::format("unhandled relocation type #{0}", type));
 	}
 
 	// write any bytes left over
@@ -633,16 +1606,56 @@ void event_object::write_section_data_event(
 
 		int alignment = prev_tail_offset & ALIGNMENT_MASK;
 
-		std::span<const unsigned char> bytes(
-			section.data() + prev_tail_offset,
-			section.size() - prev_tail_offset);
+		auto bytes = section.bytes(prev_tail_offset, section.size() - prev_tail_offset);
 
 		write_event_bytes(output, alignment, bytes);
 	}
 }
 
-std::unordered_map<std::string_view, size_t> event_object::make_absolute_symbol_map() const {
-	std::unordered_map<std::string_view, size_t> result;
+std::vector<unsigned> event_object::section_offsets() const {
+	std::vector<unsigned> result;
+	result.reserve(mSections.size());
+
+	unsigned offset = 0;
+
+	for (auto& section : mSections) {
+		if (section.is_placed()) {
+			result.push_back(section.address());
+			continue;
+		}
+
+		result.push_back(offset);
+
+		offset += section.size();
+
+		if (unsigned misalign = (offset % 4))
+			offset += (4 - misalign);
+	}
+
+	return result;
+}
+
+void event_object::erase_defined_symbols(absolute_symbol_map& abs_symbol_map) const {
+	// symbols defined here take precedence over absolute ones (this is how replacements work)
+	// relocations to those can still be around when they are between placed and streamed sections
+
+	// they are marked rather than erased, so that they also hide the symbols of databases
+
+	for (auto& section : mSections) {
+		for (std::size_t i = 0; i < section.symbols().size(); ++i) {
+			symbol_ref name = section.symbol_name(i);
+
+			if (auto it = abs_symbol_map.find(name); it != abs_symbol_map.end())
+				it->second = NOT_ABSOLUTE;
+			else if (!mSymbolDbs.empty() && !name.is_local_key())
+				abs_symbol_map.emplace(name, NOT_ABSOLUTE);
+		}
+	}
+}
+
+event_object::absolute_symbol_map event_object::make_absolute_symbol_map() const {
+	absolute_symbol_map result;
+	result.reserve(mAbsoluteSymbols.size());
 
 	for (size_t i = 0; i < mAbsoluteSymbols.size(); i++) {
 		result.insert({ mAbsoluteSymbols[i].name, i });
@@ -651,4 +1664,25 @@ std::unordered_map<std::string_view, size_t> event_object::make_absolute_symbol_
 	return result;
 }
 
+std::optional<event_object::absolute_symbol> event_object::find_absolute_symbol(const absolute_symbol_map& abs_symbol_map, const symbol_ref& name) const {
+	if (auto it = abs_symbol_map.find(name); it != abs_symbol_map.end()) {
+		if (it->second == NOT_ABSOLUTE)
+			return std::nullopt;
+
+		return mAbsoluteSymbols[it->second];
+	}
+
+	if (name.is_local_key())
+		return std::nullopt;
+
+	for (auto& db : mSymbolDbs) {
+		if (auto index = db->find(name.text())) {
+			auto entry = db->at(*index);
+			return absolute_symbol { entry.name, entry.address, entry.size, entry.isFunction };
+		}
+	}
+
+	return std::nullopt;
+}
+
 } // namespace lyn
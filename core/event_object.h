@@ -2,8 +2,24 @@
 #define EVENT_OBJECT_H
 
 #include "arm_relocator.h"
+#include "branch_index.h"
+#include "content_cache.h"
+#include "layout_profile.h"
+#include "prepared_file.h"
+#include "region_allocator.h"
 #include "section_data.h"
+#include "string_pool.h"
+#include "symbol_db.h"
+#include "symbol_ref.h"
+
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace lyn {
 
@@ -12,10 +28,51 @@ public:
 	struct hook {
 		unsigned int originalOffset;
 		std::string name;
+
+		// ROM offset (with thumb bit) of the replacement, if it is placed
+		std::optional<unsigned int> replacementOffset;
+	};
+
+	struct absolute_symbol {
+		symbol_ref name;
+		unsigned int offset;
+		unsigned int size;
+		bool is_function;
 	};
 
 public:
+	/* objects are looked up in the object cache first, if there is one (and added to it as prepared objects when they aren't there) */
 	void append_from_elf(const char* fName);
+	void append_from_elf(std::string_view name, std::span<const std::uint8_t> data);
+
+	/* appends ELF and prepared objects (told apart by their contents), in order
+	 * when possible, they are loaded in parallel (see lyn::parallel_for) before being appended one after the other */
+	void append_from_objects(const std::vector<std::string>& fileNames);
+
+	/* the cache (and what it did for this link, in stats) is kept by the caller, and has to outlive the appending of objects */
+	void set_object_cache(content_cache* cache, content_cache::statistics* stats) { mObjectCache = cache; mObjectCacheStats = stats; }
+
+	/* appends the members of the archives that define symbols referred to but not yet defined, as a linker would
+	 * this goes on until no member is needed anymore, so members can depend on each other (even across archives) */
+	void append_from_archives(const std::vector<std::string>& fileNames);
+
+	/* appends the symbols of a text symbol list (see lyn::parse_symbol_list) as absolute symbols */
+	void append_from_symbol_list(const char* fileName);
+
+	/* appends a prepared object (.lyo, see write_prepared), which holds sections as they are once loaded */
+	void append_from_prepared(const char* fileName);
+	void append_from_prepared(std::string_view name, std::span<const std::uint8_t> data);
+
+	/* writes everything appended so far as a prepared object, for links that load the same objects over and over
+	 * this is meant for objects that were just appended (before any linking), as `lyn prep` does */
+	void write_prepared(const std::string& fileName) const;
+
+	/* absolute symbols can also come from precompiled databases (see lyn::symbol_db)
+	 * those are looked up by name when needed, after the absolute symbols of the objects */
+	void add_symbol_db(const std::string& fileName);
+
+	void apply_layout(const layout_profile& profile, std::ostream* report);
+	void allocate_regions(region_allocator& allocator, std::ostream* report);
 
 	void try_transform_relatives();
 
@@ -26,28 +83,86 @@ public:
 
 	void cleanup();
 
+	/* places functions replacing an absolute symbol directly at its address, when they fit and are in the same instruction set (thumb or ARM) */
+	void place_replacements();
+
 	std::vector<hook> get_hooks() const;
 
+	/* ROM ranges of the functions the absolute symbols (from objects and databases) give a size to, as code for branch_index */
+	std::vector<branch_index::code_range> rom_functions() const;
+
+	/* ROM ranges the placed sections are written to */
+	std::vector<branch_index::rom_range> placed_ranges() const;
+
 	void add_section(section_data&& section) {
 		mSections.push_back(std::move(section));
 	}
 
 	void write_events(std::ostream& output) const;
 
-	const std::vector<section_data::symbol>& absolute_symbols() const { return mAbsoluteSymbols; }
+	const std::pmr::vector<absolute_symbol>& absolute_symbols() const { return mAbsoluteSymbols; }
+
+	/* files appended from so far (objects, archives, symbol lists and databases), in order, for dependency files */
+	const std::vector<std::string>& input_files() const { return mInputFiles; }
 
 private:
+	/* index in mAbsoluteSymbols by name
+	 * names mapped to NOT_ABSOLUTE are defined in sections, which takes precedence over absolute symbols from anywhere */
+	using absolute_symbol_map = std::unordered_map<symbol_ref, size_t, symbol_ref::hash>;
+
+	static constexpr size_t NOT_ABSOLUTE = ~size_t(0);
+
+	/* looks in the map first, then in the symbol databases */
+	std::optional<absolute_symbol> find_absolute_symbol(const absolute_symbol_map& abs_symbol_map, const symbol_ref& name) const;
+
+	/* an object loaded on its own (by append_from_objects), as a prepared object */
+	struct loaded_object {
+		content_cache::entry prepared;
+		std::optional<std::uint64_t> cacheKey; // if it came from the cache
+
+		std::exception_ptr error;
+	};
+
+	loaded_object load_object(const std::string& fileName) const;
+
+	/* appends the cached object with that key, returns false if there's none (or if it can't be used) */
+	bool append_from_cache(std::uint64_t key);
+
+	/* decodes an ELF object (append_from_elf without the cache) */
+	void load_elf(std::string_view name, std::span<const std::uint8_t> data);
+
+	/* sections and absolute symbols from the given ones on, as a prepared object */
+	prepared_writer make_prepared(std::size_t sectionBegin, std::size_t absoluteBegin) const;
+
+	/* offset of each section: its ROM offset for placed sections, its offset in the stream for the others */
+	std::vector<unsigned> section_offsets() const;
+
+	/* placement, symbols and data of one section */
+	void write_section_events(std::ostream& output, const section_data& section, const absolute_symbol_map& abs_symbol_map) const;
+
 	void write_section_data_event(
 		std::ostream& output,
 		const section_data& section,
-		const std::unordered_map<std::string_view, size_t>& abs_symbol_map) const;
+		const absolute_symbol_map& abs_symbol_map) const;
+
+	absolute_symbol_map make_absolute_symbol_map() const;
+	void erase_defined_symbols(absolute_symbol_map& abs_symbol_map) const;
+
+	/* everything the object holds is allocated from this, and freed in one go with it
+	 * (this has to be declared first, so that it outlives what lives in it) */
+	std::pmr::monotonic_buffer_resource mArena;
+
+	std::pmr::vector<section_data> mSections { &mArena };
+
+	string_pool mAbsoluteNames { &mArena };
+	std::pmr::vector<absolute_symbol> mAbsoluteSymbols { &mArena };
 
-	std::unordered_map<std::string_view, size_t> make_absolute_symbol_map() const;
+	std::vector<std::unique_ptr<symbol_db>> mSymbolDbs;
 
-	arm_relocator mRelocator;
+	content_cache* mObjectCache = nullptr;
+	content_cache::statistics* mObjectCacheStats = nullptr;
 
-	std::vector<section_data> mSections;
-	std::vector<section_data::symbol> mAbsoluteSymbols;
+	std::vector<std::string> mInputFiles;
 };
 
 } // namespace lyn
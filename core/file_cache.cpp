@@ -0,0 +1,91 @@
+#include "file_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+#include "mapped_file.h"
+
+namespace lyn {
+
+std::filesystem::path cache_directory() {
+	std::filesystem::path result;
+
+	if (const char* path = std::getenv("LYN_CACHE")) {
+		result = path;
+	} else if (const char* path = std::getenv("XDG_CACHE_HOME")) {
+		result = std::filesystem::path(path) / "lyn";
+	} else if (const char* path = std::getenv("LOCALAPPDATA")) {
+		result = std::filesystem::path(path) / "lyn";
+	} else if (const char* path = std::getenv("HOME")) {
+		result = std::filesystem::path(path) / ".cache" / "lyn";
+	}
+
+	if (result.empty())
+		return result;
+
+	std::error_code error;
+	std::filesystem::create_directories(result, error);
+
+	if (error)
+		return std::filesystem::path();
+
+	return result;
+}
+
+void replace_file(const std::filesystem::path& fileName, std::span<const std::uint8_t> data) {
+	auto temporary = fileName;
+	temporary += std::format(".{0:X}", std::random_device()());
+
+	{
+		std::ofstream output(temporary, std::ios::out | std::ios::binary);
+
+		if (!output.is_open())
+			throw std::runtime_error(std::format("Couldn't open file for write: {0}", temporary.string()));
+
+		output.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+		// (some errors, such as the disk being full, only show when what's buffered is written out)
+
+		output.close();
+
+		if (!output) {
+			std::error_code error;
+			std::filesystem::remove(temporary, error);
+
+			throw std::runtime_error(std::format("Couldn't write to file: {0}", temporary.string()));
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, fileName, error);
+
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		throw std::runtime_error(std::format("Couldn't write to file: {0}", fileName.string()));
+	}
+}
+
+bool update_file(const std::filesystem::path& fileName, std::span<const std::uint8_t> data) {
+	std::error_code error;
+
+	if (std::filesystem::is_regular_file(fileName, error) && std::filesystem::file_size(fileName, error) == data.size() && !error) {
+		try {
+			const mapped_file file(fileName.string());
+
+			if (std::equal(data.begin(), data.end(), file.data()))
+				return false;
+		} catch (const std::exception&) {
+			// can't read it, so it is written over
+		}
+	}
+
+	replace_file(fileName, data);
+	return true;
+}
+
+} // namespace lyn
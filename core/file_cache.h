@@ -0,0 +1,29 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace lyn {
+
+/* directory where lyn keeps cached data between runs
+ * this is $LYN_CACHE, or a lyn directory in the user's cache directory
+ * returns an empty path when there is nowhere to cache things, in which case caching is skipped */
+
+std::filesystem::path cache_directory();
+
+/* writes a whole file to a temporary next to it, which is then renamed over it
+ * so that concurrent runs (or a link that has the old file mapped) never see a partial file
+ * throws if the file can't be written */
+
+void replace_file(const std::filesystem::path& fileName, std::span<const std::uint8_t> data);
+
+/* replaces a file (as replace_file does) only if what's in it differs, so that its modification time only changes with its contents
+ * returns whether the file was written */
+
+bool update_file(const std::filesystem::path& fileName, std::span<const std::uint8_t> data);
+
+} // namespace lyn
+
+#endif // FILE_CACHE_H
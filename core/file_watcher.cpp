@@ -0,0 +1,117 @@
+#include "file_watcher.h"
+
+#include <format>
+#include <set>
+#include <stdexcept>
+
+#ifdef __linux__
+#  include <cerrno>
+#  include <poll.h>
+#  include <sys/inotify.h>
+#  include <unistd.h>
+#endif
+
+namespace lyn {
+
+#ifdef __linux__
+
+namespace {
+
+// a compiler writing an object does it in several writes (or several files), those are only looked at once it's done
+
+constexpr int SETTLE_MILLISECONDS = 50;
+
+std::string full_path(const std::string& fileName) {
+	return std::filesystem::absolute(fileName).lexically_normal().string();
+}
+
+} // namespace
+
+file_watcher::file_watcher(const std::vector<std::string>& fileNames) {
+	mFd = ::inotify_init1(IN_CLOEXEC);
+
+	if (mFd < 0)
+		throw std::runtime_error("couldn't set up inotify");
+
+	for (auto& fileName : fileNames) {
+		std::string path = full_path(fileName);
+		std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+		int watch = ::inotify_add_watch(mFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+		if (watch < 0) {
+			::close(mFd);
+			throw std::runtime_error(std::format("{0}: couldn't watch directory", directory.string()));
+		}
+
+		// (watching a directory again gives the same descriptor)
+
+		mDirectories.emplace(watch, std::move(directory));
+		mFiles.emplace(std::move(path), fileName);
+	}
+}
+
+file_watcher::~file_watcher() {
+	::close(mFd);
+}
+
+std::vector<std::string> file_watcher::wait_for_changes() {
+	std::set<std::string> changed;
+
+	for (;;) {
+		pollfd request { mFd, POLLIN, 0 };
+
+		int ready = ::poll(&request, 1, changed.empty() ? -1 : SETTLE_MILLISECONDS);
+
+		if (ready < 0 && errno == EINTR)
+			continue;
+
+		if (ready < 0)
+			throw std::runtime_error("couldn't wait for files to change");
+
+		if (ready == 0)
+			break; // settled
+
+		alignas(inotify_event) char buffer[0x1000];
+		ssize_t size = ::read(mFd, buffer, sizeof(buffer));
+
+		if (size < 0 && errno == EINTR)
+			continue;
+
+		if (size <= 0)
+			throw std::runtime_error("couldn't wait for files to change");
+
+		for (const char* it = buffer; it < buffer + size;) {
+			auto* event = reinterpret_cast<const inotify_event*>(it);
+			it += sizeof(inotify_event) + event->len;
+
+			auto directory = mDirectories.find(event->wd);
+
+			if (event->len == 0 || directory == mDirectories.end())
+				continue;
+
+			auto file = mFiles.find((directory->second / event->name).string());
+
+			if (file != mFiles.end())
+				changed.insert(file->second);
+		}
+	}
+
+	return std::vector<std::string>(changed.begin(), changed.end());
+}
+
+#else // __linux__
+
+file_watcher::file_watcher(const std::vector<std::string>&) {
+	throw std::runtime_error("-watch needs inotify, which only linux has");
+}
+
+file_watcher::~file_watcher() {}
+
+std::vector<std::string> file_watcher::wait_for_changes() {
+	return std::vector<std::string>();
+}
+
+#endif // __linux__
+
+} // namespace lyn
@@ -0,0 +1,42 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief waits for files to change (as used by -watch)
+ *
+ * This watches the directories holding the files rather than the files
+ * themselves, as tools often replace files (by writing another and renaming
+ * it over) rather than writing them in place.
+ *
+ * This needs inotify, which only linux has.
+ *
+ */
+class file_watcher {
+public:
+	explicit file_watcher(const std::vector<std::string>& fileNames);
+	~file_watcher();
+
+	file_watcher(const file_watcher&) = delete;
+	file_watcher& operator = (const file_watcher&) = delete;
+
+	/* blocks until some of the files are written, then until they stop being written for a bit
+	 * returns the names of those that were (as they were given) */
+	std::vector<std::string> wait_for_changes();
+
+private:
+	int mFd = -1;
+
+	std::unordered_map<int, std::filesystem::path> mDirectories; // by watch descriptor
+	std::unordered_map<std::string, std::string> mFiles; // given names by full path
+};
+
+} // namespace lyn
+
+#endif // FILE_WATCHER_H
@@ -0,0 +1,166 @@
+#include "free_space.h"
+
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "content_cache.h"
+#include "hash.h"
+#include "mapped_file.h"
+
+namespace lyn {
+
+// whether any byte of the word is zero (the usual bit trick)
+
+static bool has_zero_byte(std::uint64_t word) {
+	return ((word - 0x0101010101010101ull) & ~word & 0x8080808080808080ull) != 0;
+}
+
+std::vector<free_run> find_free_space(std::span<const std::uint8_t> rom, unsigned minSize, unsigned align) {
+	std::vector<free_run> result;
+
+	auto addRun = [&result, minSize, align] (std::size_t begin, std::size_t end) {
+		if (std::size_t misalign = (begin % align))
+			begin += align - misalign;
+
+		if (begin < end && (end - begin) >= minSize)
+			result.push_back({ static_cast<unsigned>(begin), static_cast<unsigned>(end - begin) });
+	};
+
+	const std::uint8_t* data = rom.data();
+	const std::size_t size = rom.size();
+
+	std::size_t runBegin = 0;
+	std::uint8_t runByte = size ? data[0] : 0;
+
+	std::size_t i = 0;
+
+	while (i < size) {
+		bool isFiller = (runByte == 0x00 || runByte == 0xFF);
+
+		// fast path: skip 8 bytes at a time while they all match the current run
+		// (or, outside of runs, while none of them can start one)
+
+		if (i % 8 == 0) {
+			std::uint64_t fill = runByte ? ~std::uint64_t(0) : 0;
+
+			while (i + 8 <= size) {
+				std::uint64_t word;
+				std::memcpy(&word, data + i, 8);
+
+				if (isFiller && word != fill)
+					break;
+
+				if (!isFiller && (has_zero_byte(word) || has_zero_byte(~word)))
+					break;
+
+				i += 8;
+			}
+
+			if (i >= size)
+				break;
+		}
+
+		std::uint8_t byte = data[i];
+
+		if (byte != runByte) {
+			if (isFiller)
+				addRun(runBegin, i);
+
+			runBegin = i;
+			runByte = byte;
+		}
+
+		i++;
+	}
+
+	if (size && (runByte == 0x00 || runByte == 0xFF))
+		addRun(runBegin, size);
+
+	return result;
+}
+
+/* cached runs are one `<offset> <size>` line each (in hex), followed by an `end <count>` line
+ * a list without its end (as when writing it failed halfway) isn't one */
+
+static bool parse_hex(std::string_view text, unsigned& result) {
+	auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result, 16);
+	return error == std::errc() && end == text.data() + text.size() && !text.empty();
+}
+
+static std::optional<std::vector<free_run>> parse_free_runs(std::span<const std::uint8_t> bytes) {
+	std::string_view text(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	std::vector<free_run> result;
+
+	while (!text.empty()) {
+		auto end = text.find('\n');
+
+		if (end == std::string_view::npos)
+			return std::nullopt;
+
+		auto line = text.substr(0, end);
+		text.remove_prefix(end + 1);
+
+		auto space = line.find(' ');
+
+		if (space == std::string_view::npos)
+			return std::nullopt;
+
+		if (line.substr(0, space) == "end") {
+			unsigned count = 0;
+
+			if (!parse_hex(line.substr(space + 1), count) || count != result.size() || !text.empty())
+				return std::nullopt;
+
+			return result;
+		}
+
+		free_run run;
+
+		if (!parse_hex(line.substr(0, space), run.offset) || !parse_hex(line.substr(space + 1), run.size))
+			return std::nullopt;
+
+		result.push_back(run);
+	}
+
+	return std::nullopt;
+}
+
+std::vector<free_run> find_free_space_cached(const mapped_file& rom, unsigned minSize, unsigned align,
+	const std::filesystem::path& cacheDirectory, std::uintmax_t cacheSize) {
+	if (cacheDirectory.empty())
+		return find_free_space(rom.bytes(), minSize, align);
+
+	// (lists are kept like other cached things, so that those of ROMs that aren't used anymore go away)
+
+	content_cache cache(cacheDirectory / "free", ".txt", cacheSize);
+	content_cache::statistics stats;
+
+	const auto key = hash_string(std::format("freemin={0} freealign={1}", minSize, align), content_cache::key_of(rom.bytes()));
+
+	if (auto entry = cache.find(key)) {
+		if (auto runs = parse_free_runs(entry->bytes)) {
+			cache.record_hit(key, stats);
+			return std::move(*runs);
+		}
+	}
+
+	auto result = find_free_space(rom.bytes(), minSize, align);
+
+	std::string text;
+
+	for (auto& run : result)
+		text += std::format("{0:X} {1:X}\n", run.offset, run.size);
+
+	text += std::format("end {0:X}\n", result.size());
+
+	cache.store(key, std::span(reinterpret_cast<const std::uint8_t*>(text.data()), text.size()), stats);
+	cache.trim(stats);
+
+	return result;
+}
+
+} // namespace lyn
@@ -0,0 +1,30 @@
+#ifndef FREE_SPACE_H
+#define FREE_SPACE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace lyn {
+
+class mapped_file;
+
+struct free_run {
+	unsigned offset;
+	unsigned size;
+};
+
+/* finds runs of 0x00 or 0xFF filler bytes that are at least minSize bytes long once aligned */
+
+std::vector<free_run> find_free_space(std::span<const std::uint8_t> rom, unsigned minSize, unsigned align);
+
+/* same as find_free_space, but the result is cached in the given cache directory, see lyn::cache_directory
+ * (keyed on the contents of the ROM and the options, and trimmed to cacheSize bytes, see lyn::content_cache) */
+
+std::vector<free_run> find_free_space_cached(const mapped_file& rom, unsigned minSize, unsigned align,
+	const std::filesystem::path& cacheDirectory, std::uintmax_t cacheSize);
+
+} // namespace lyn
+
+#endif // FREE_SPACE_H
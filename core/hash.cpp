@@ -0,0 +1,102 @@
+#include "hash.h"
+
+#include <bit>
+#include <cstring>
+
+namespace lyn {
+
+namespace {
+
+constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ull;
+constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+template<typename IntType>
+IntType load_le(const std::uint8_t* data) {
+	IntType result;
+	std::memcpy(&result, data, sizeof(IntType));
+
+	if constexpr (std::endian::native == std::endian::big) {
+		IntType swapped = 0;
+
+		for (unsigned i = 0; i < sizeof(IntType); ++i)
+			swapped |= ((result >> (i * 8)) & 0xFF) << ((sizeof(IntType) - 1 - i) * 8);
+
+		result = swapped;
+	}
+
+	return result;
+}
+
+std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+	acc += input * PRIME2;
+	acc = std::rotl(acc, 31);
+	return acc * PRIME1;
+}
+
+std::uint64_t merge_round(std::uint64_t acc, std::uint64_t value) {
+	acc ^= round(0, value);
+	return acc * PRIME1 + PRIME4;
+}
+
+} // namespace
+
+std::uint64_t hash_bytes(std::span<const std::uint8_t> bytes, std::uint64_t seed) {
+	const std::uint8_t* data = bytes.data();
+	const std::uint8_t* const end = data + bytes.size();
+
+	std::uint64_t result;
+
+	if (bytes.size() >= 32) {
+		std::uint64_t v1 = seed + PRIME1 + PRIME2;
+		std::uint64_t v2 = seed + PRIME2;
+		std::uint64_t v3 = seed;
+		std::uint64_t v4 = seed - PRIME1;
+
+		for (; data + 32 <= end; data += 32) {
+			v1 = round(v1, load_le<std::uint64_t>(data + 0));
+			v2 = round(v2, load_le<std::uint64_t>(data + 8));
+			v3 = round(v3, load_le<std::uint64_t>(data + 16));
+			v4 = round(v4, load_le<std::uint64_t>(data + 24));
+		}
+
+		result = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+
+		result = merge_round(result, v1);
+		result = merge_round(result, v2);
+		result = merge_round(result, v3);
+		result = merge_round(result, v4);
+	} else {
+		result = seed + PRIME5;
+	}
+
+	result += bytes.size();
+
+	for (; data + 8 <= end; data += 8) {
+		result ^= round(0, load_le<std::uint64_t>(data));
+		result = std::rotl(result, 27) * PRIME1 + PRIME4;
+	}
+
+	if (data + 4 <= end) {
+		result ^= load_le<std::uint32_t>(data) * PRIME1;
+		result = std::rotl(result, 23) * PRIME2 + PRIME3;
+		data += 4;
+	}
+
+	for (; data < end; ++data) {
+		result ^= (*data) * PRIME5;
+		result = std::rotl(result, 11) * PRIME1;
+	}
+
+	result ^= result >> 33;
+	result *= PRIME2;
+	result ^= result >> 29;
+	result *= PRIME3;
+	result ^= result >> 32;
+
+	return result;
+}
+
+} // namespace lyn
@@ -0,0 +1,20 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace lyn {
+
+/* fast non-cryptographic 64-bit hash (this is XXH64), used to key caches on file contents */
+
+std::uint64_t hash_bytes(std::span<const std::uint8_t> bytes, std::uint64_t seed = 0);
+
+inline std::uint64_t hash_string(std::string_view string, std::uint64_t seed = 0) {
+	return hash_bytes({ reinterpret_cast<const std::uint8_t*>(string.data()), string.size() }, seed);
+}
+
+} // namespace lyn
+
+#endif // HASH_H
@@ -0,0 +1,210 @@
+#include "jobserver.h"
+
+#include <cstdlib>
+#include <format>
+#include <string>
+
+#ifndef _WIN32
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace lyn {
+
+#ifndef _WIN32
+
+namespace {
+
+bool is_fifo(int fd) {
+	struct stat info;
+	return ::fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+}
+
+// opening the descriptor again gives it a file description of its own, which can be made non blocking without make seeing it
+// (this is linux only, elsewhere the jobserver just never has tokens)
+
+int reopen_descriptor(int fd, int flags) {
+	if (::fcntl(fd, F_GETFD) == -1 || !is_fifo(fd))
+		return -1;
+
+	return ::open(std::format("/proc/self/fd/{0}", fd).c_str(), flags | O_CLOEXEC);
+}
+
+int open_fifo(const std::string& path, int flags) {
+	int fd = ::open(path.c_str(), flags | O_NONBLOCK | O_CLOEXEC);
+
+	if (fd >= 0 && !is_fifo(fd)) {
+		::close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+bool parse_descriptor(std::string_view text, int& fd) {
+	if (text.empty())
+		return false;
+
+	fd = 0;
+
+	for (char c : text) {
+		if (c < '0' || c > '9' || fd > 0xFFFF)
+			return false;
+
+		fd = fd * 10 + (c - '0');
+	}
+
+	return true;
+}
+
+} // namespace
+
+jobserver::~jobserver() {
+	while (!mTokens.empty())
+		release();
+
+	if (mReadFd >= 0)
+		::close(mReadFd);
+
+	if (mWriteFd >= 0)
+		::close(mWriteFd);
+}
+
+jobserver* jobserver::from_environment() {
+	static const std::unique_ptr<jobserver> instance = [] () {
+		const char* makeFlags = std::getenv("MAKEFLAGS");
+		return from_make_flags(makeFlags ? makeFlags : "");
+	}();
+
+	return instance.get();
+}
+
+std::unique_ptr<jobserver> jobserver::from_make_flags(std::string_view makeFlags) {
+	// the last one given wins, and what comes after `--` are variables rather than flags
+
+	std::string_view auth;
+	bool hasJobserver = false;
+
+	while (!makeFlags.empty()) {
+		auto end = makeFlags.find(' ');
+		auto flag = makeFlags.substr(0, end);
+
+		makeFlags.remove_prefix(end == std::string_view::npos ? makeFlags.size() : end + 1);
+
+		if (flag == "--")
+			break;
+
+		for (std::string_view prefix : { "--jobserver-auth=", "--jobserver-fds=" }) {
+			if (flag.starts_with(prefix)) {
+				auth = flag.substr(prefix.size());
+				hasJobserver = true;
+			}
+		}
+	}
+
+	if (!hasJobserver)
+		return nullptr;
+
+	int readFd = -1, writeFd = -1;
+	std::string fifoPath;
+
+	if (auth.starts_with("fifo:")) {
+		const std::string path(auth.substr(5));
+		fifoPath = path;
+
+		readFd = open_fifo(path, O_RDONLY);
+		writeFd = open_fifo(path, O_WRONLY);
+
+		// (writes are small enough to never block, so they may as well wait)
+
+		if (writeFd >= 0)
+			::fcntl(writeFd, F_SETFL, ::fcntl(writeFd, F_GETFL) & ~O_NONBLOCK);
+	} else if (auto comma = auth.find(','); comma != std::string_view::npos) {
+		int inheritedRead, inheritedWrite;
+
+		if (parse_descriptor(auth.substr(0, comma), inheritedRead) && parse_descriptor(auth.substr(comma + 1), inheritedWrite)) {
+			readFd = reopen_descriptor(inheritedRead, O_RDONLY | O_NONBLOCK);
+			writeFd = reopen_descriptor(inheritedWrite, O_WRONLY);
+
+			// (a pipe opened through /proc can be both read and written, as a fifo would)
+
+			fifoPath = std::format("/proc/{0}/fd/{1}", ::getpid(), readFd);
+		}
+	}
+
+	if (readFd < 0 || writeFd < 0) {
+		if (readFd >= 0)
+			::close(readFd);
+
+		if (writeFd >= 0)
+			::close(writeFd);
+
+		readFd = writeFd = -1;
+		fifoPath.clear();
+	}
+
+	return std::unique_ptr<jobserver>(new jobserver(readFd, writeFd, std::move(fifoPath)));
+}
+
+bool jobserver::try_acquire() {
+	if (mReadFd < 0)
+		return false;
+
+	char token;
+	ssize_t size;
+
+	do
+		size = ::read(mReadFd, &token, 1);
+	while (size < 0 && errno == EINTR);
+
+	if (size != 1)
+		return false;
+
+	std::lock_guard lock(mMutex);
+	mTokens.push_back(token);
+
+	return true;
+}
+
+void jobserver::release() {
+	char token;
+
+	{
+		std::lock_guard lock(mMutex);
+
+		if (mTokens.empty())
+			return;
+
+		token = mTokens.back();
+		mTokens.pop_back();
+	}
+
+	while (::write(mWriteFd, &token, 1) < 0 && errno == EINTR)
+		;
+}
+
+#else // _WIN32
+
+// make on windows gives a semaphore rather than a pipe, which isn't supported (lyn then goes by -j or the hardware)
+
+jobserver::~jobserver() {}
+
+jobserver* jobserver::from_environment() {
+	return nullptr;
+}
+
+std::unique_ptr<jobserver> jobserver::from_make_flags(std::string_view) {
+	return nullptr;
+}
+
+bool jobserver::try_acquire() {
+	return false;
+}
+
+void jobserver::release() {}
+
+#endif // _WIN32
+
+} // namespace lyn
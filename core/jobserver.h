@@ -0,0 +1,72 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief client of the GNU make jobserver
+ *
+ * When run by `make -jN` (or by anything else implementing the protocol, like
+ * recent versions of ninja), lyn is given a pipe or a fifo holding tokens
+ * shared by every job of the build. Every job implicitly holds one token, and
+ * has to take one more from the jobserver for each thread it runs on top of
+ * that (and to give it back after). This way, lyn only uses more threads when
+ * the build doesn't already keep the machine busy.
+ *
+ * The jobserver is given through $MAKEFLAGS, as `--jobserver-auth=R,W` (two
+ * inherited descriptors), `--jobserver-auth=fifo:PATH` (make 4.4) or
+ * `--jobserver-fds=R,W` (older versions of make).
+ *
+ * Tokens are only ever taken without waiting, so that a busy build doesn't
+ * hold up lyn: it then just runs on fewer threads.
+ *
+ */
+class jobserver {
+public:
+	~jobserver();
+
+	jobserver(const jobserver&) = delete;
+	jobserver& operator = (const jobserver&) = delete;
+
+	/* the jobserver given through $MAKEFLAGS (which lives until lyn exits), nullptr if there's none
+	 * one that can't be used (make only passes its descriptors to the commands it knows to be recursive) never has tokens */
+	static jobserver* from_environment();
+
+	/* the jobserver described by these make flags, nullptr if there's none */
+	static std::unique_ptr<jobserver> from_make_flags(std::string_view makeFlags);
+
+	/* takes a token if one is available right away */
+	bool try_acquire();
+
+	/* gives back a token taken by try_acquire */
+	void release();
+
+	/* fifo through which another process of the same user can share this jobserver (see lyn::link_request)
+	 * for a pipe, this is the descriptor of this process in /proc, which is only there for as long as this jobserver is
+	 * empty if it can't be shared this way (or has no tokens to share) */
+	const std::string& fifo_path() const { return mFifoPath; }
+
+private:
+	jobserver(int readFd, int writeFd, std::string fifoPath) : mReadFd(readFd), mWriteFd(writeFd), mFifoPath(std::move(fifoPath)) {}
+
+	// (opened again by lyn, so that reading them without waiting doesn't change how make reads them)
+	int mReadFd;
+	int mWriteFd;
+
+	std::string mFifoPath;
+
+	// the token characters have to be given back as they were taken
+	std::mutex mMutex;
+	std::vector<char> mTokens;
+};
+
+} // namespace lyn
+
+#endif // JOBSERVER_H
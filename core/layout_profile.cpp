@@ -0,0 +1,76 @@
+#include "layout_profile.h"
+
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "text_parse.h"
+
+namespace lyn {
+
+void layout_profile::load_from_file(const char* fileName) {
+	std::ifstream input(fileName);
+
+	if (!input.is_open())
+		throw std::runtime_error(std::format("Couldn't open profile for read: {0}", fileName));
+
+	std::string line;
+	unsigned lineNumber = 0;
+
+	// (the first entry tells whether the profile has cycles, every other one has to agree)
+
+	unsigned firstLineNumber = 0;
+
+	while (std::getline(input, line)) {
+		lineNumber++;
+
+		auto tokens = split_config_line(line);
+
+		if (tokens.empty())
+			continue;
+
+		entry newEntry { 0, 0 };
+
+		if (tokens.size() < 2 || tokens.size() > 3
+			|| !parse_config_number(tokens[1], newEntry.calls)
+			|| (tokens.size() == 3 && !parse_config_number(tokens[2], newEntry.cycles)))
+		{
+			throw std::runtime_error(std::format("{0}:{1}: expected `<symbol> <calls> [<cycles>]`", fileName, lineNumber));
+		}
+
+		const bool hasCycles = tokens.size() == 3;
+
+		if (firstLineNumber == 0) {
+			firstLineNumber = lineNumber;
+			mHasCycles = hasCycles;
+		} else if (hasCycles != mHasCycles) {
+			throw std::runtime_error(std::format("{0}:{1}: {2} cycles, while line {3} {4} (cycles are to be given on every line or on none)",
+				fileName, lineNumber, hasCycles ? "gives" : "doesn't give", firstLineNumber, mHasCycles ? "does" : "doesn't"));
+		}
+
+		// names are matched against lyn symbol names, which have their dots replaced
+
+		std::string& name = tokens[0];
+
+		for (char& c : name)
+			if (c == '.')
+				c = '_';
+
+		auto& existing = mEntries[name];
+
+		existing.calls  += newEntry.calls;
+		existing.cycles += newEntry.cycles;
+	}
+}
+
+unsigned long long layout_profile::weight(std::string_view name) const {
+	auto it = mEntries.find(std::string(name));
+
+	if (it == mEntries.end())
+		return 0;
+
+	return mHasCycles ? it->second.cycles : it->second.calls;
+}
+
+} // namespace lyn
@@ -0,0 +1,48 @@
+#ifndef LAYOUT_PROFILE_H
+#define LAYOUT_PROFILE_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace lyn {
+
+/*!
+ * \brief per-symbol execution profile, as exported by an emulator profiler
+ *
+ * The profile file is a plain text file with one symbol per line:
+ *
+ *     <symbol name> <call count> [<cycles>]
+ *
+ * Fields may be separated by whitespace or commas. Numbers can be decimal or
+ * hexadecimal (`0x` or `$` prefix). Empty lines and lines starting with `#` or
+ * `;` are ignored.
+ *
+ * Cycles are given either on every line or on none, so that all weights are
+ * in the same unit.
+ *
+ */
+class layout_profile {
+public:
+	struct entry {
+		unsigned long long calls;
+		unsigned long long cycles;
+	};
+
+public:
+	void load_from_file(const char* fileName);
+
+	/* weight used for ordering: cycles when the profiler gave them, call count otherwise */
+	unsigned long long weight(std::string_view name) const;
+
+	bool empty() const { return mEntries.empty(); }
+
+private:
+	std::unordered_map<std::string, entry> mEntries;
+
+	bool mHasCycles = false;
+};
+
+} // namespace lyn
+
+#endif // LAYOUT_PROFILE_H
@@ -0,0 +1,389 @@
+#include "link_server.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+#include "config.h"
+
+#include "data_chunk.h"
+#include "file_cache.h"
+
+#ifndef _WIN32
+#  include <csignal>
+#  include <cerrno>
+#  include <pthread.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+namespace lyn {
+
+std::string default_server_socket() {
+	if (const char* path = std::getenv("LYN_SERVER"); path && *path)
+		return path;
+
+	auto directory = cache_directory();
+
+	if (directory.empty())
+		return std::string();
+
+	return (directory / "server.sock").string();
+}
+
+#ifndef _WIN32
+
+namespace {
+
+constexpr std::uint32_t MAGIC = 0x324E594C; // "LYN2" (requests without the environment were "LYNS")
+
+constexpr std::uint32_t STATUS_DONE = 0;
+constexpr std::uint32_t STATUS_REFUSED = 1;
+
+// requests are small, anything bigger than this is a stray connection rather than a client
+
+constexpr std::uint32_t MAX_REQUEST_STRING = 0x10000;
+constexpr std::uint32_t MAX_REQUEST_ARGUMENTS = 0x10000;
+
+constexpr int REQUEST_TIMEOUT_SECONDS = 10;
+
+// the response holds the whole output of a link
+
+constexpr std::uint32_t MAX_RESPONSE_STRING = 0x40000000;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL; // a peer going away is an error, rather than SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+volatile std::sig_atomic_t gStopRequested = 0;
+
+extern "C" void request_stop(int) {
+	gStopRequested = 1;
+}
+
+/* sockets are closed when these go out of scope */
+
+class socket_fd {
+public:
+	explicit socket_fd(int fd = -1) : mFd(fd) {}
+	~socket_fd() { if (mFd >= 0) ::close(mFd); }
+
+	socket_fd(const socket_fd&) = delete;
+	socket_fd& operator = (const socket_fd&) = delete;
+
+	int get() const { return mFd; }
+
+private:
+	int mFd;
+};
+
+sockaddr_un make_address(const std::string& socketPath) {
+	sockaddr_un address {};
+	address.sun_family = AF_UNIX;
+
+	if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+		throw std::runtime_error(std::format("{0}: not a usable socket path (too long?)", socketPath));
+
+	socketPath.copy(address.sun_path, socketPath.size());
+	return address;
+}
+
+// connected socket, or -1 if nothing is listening there
+
+int connect_to(const std::string& socketPath) {
+	sockaddr_un address = make_address(socketPath);
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0)
+		return -1;
+
+	if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		::close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+bool send_all(int fd, std::string_view data) {
+	while (!data.empty()) {
+		ssize_t sent = ::send(fd, data.data(), data.size(), SEND_FLAGS);
+
+		if (sent < 0 && errno == EINTR)
+			continue;
+
+		if (sent <= 0)
+			return false;
+
+		data.remove_prefix(sent);
+	}
+
+	return true;
+}
+
+bool receive_all(int fd, char* data, std::size_t size) {
+	while (size != 0) {
+		ssize_t received = ::recv(fd, data, size, 0);
+
+		if (received < 0 && errno == EINTR)
+			continue;
+
+		if (received <= 0)
+			return false;
+
+		data += received;
+		size -= received;
+	}
+
+	return true;
+}
+
+void put_word(std::string& message, std::uint32_t value) {
+	std::uint8_t bytes[4];
+	store_le<std::uint32_t>(bytes, value);
+
+	message.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+void put_string(std::string& message, std::string_view string) {
+	put_word(message, string.size());
+	message.append(string);
+}
+
+bool get_word(int fd, std::uint32_t& value) {
+	std::uint8_t bytes[4];
+
+	if (!receive_all(fd, reinterpret_cast<char*>(bytes), 4))
+		return false;
+
+	value = load_le<std::uint32_t>(bytes);
+	return true;
+}
+
+bool get_string(int fd, std::string& string, std::uint32_t maxSize) {
+	std::uint32_t size;
+
+	if (!get_word(fd, size) || size > maxSize)
+		return false;
+
+	string.resize(size);
+	return receive_all(fd, string.data(), size);
+}
+
+// reads the request of a client, and answers it once its link is done
+
+void serve_client(int fd, const link_handler& handler) {
+	socket_fd client(fd);
+
+	// a client that stops halfway through its request doesn't get to hold up its thread
+
+	timeval timeout { REQUEST_TIMEOUT_SECONDS, 0 };
+	::setsockopt(client.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	std::uint32_t magic;
+	std::string version;
+
+	if (!get_word(client.get(), magic) || magic != MAGIC || !get_string(client.get(), version, MAX_REQUEST_STRING))
+		return;
+
+	if (version != PROJECT_VERSION) {
+		std::string message;
+		put_word(message, STATUS_REFUSED);
+
+		send_all(client.get(), message);
+		return;
+	}
+
+	link_request request;
+	std::uint32_t argumentCount;
+
+	if (!get_string(client.get(), request.workingDirectory, MAX_REQUEST_STRING)
+		|| !get_word(client.get(), argumentCount) || argumentCount > MAX_REQUEST_ARGUMENTS)
+		return;
+
+	request.arguments.resize(argumentCount);
+
+	bool isComplete = true;
+
+	for (auto& argument : request.arguments)
+		isComplete = isComplete && get_string(client.get(), argument, MAX_REQUEST_STRING);
+
+	std::uint32_t cacheSizeLow, cacheSizeHigh;
+
+	if (!isComplete
+		|| !get_string(client.get(), request.cacheDirectory, MAX_REQUEST_STRING)
+		|| !get_word(client.get(), cacheSizeLow) || !get_word(client.get(), cacheSizeHigh)
+		|| !get_string(client.get(), request.jobserverFifo, MAX_REQUEST_STRING))
+		return;
+
+	request.cacheSize = (std::uint64_t(cacheSizeHigh) << 32) | cacheSizeLow;
+
+	link_response response = handler(request);
+
+	std::string message;
+
+	put_word(message, STATUS_DONE);
+	put_word(message, static_cast<std::uint32_t>(response.exitCode));
+	put_string(message, response.output);
+	put_string(message, response.errors);
+
+	send_all(client.get(), message);
+}
+
+} // namespace
+
+void serve_links(const std::string& socketPath, const link_handler& handler) {
+	sockaddr_un address = make_address(socketPath);
+
+	// a socket left behind by a server that didn't exit cleanly is replaced, one that still answers isn't
+
+	if (int fd = connect_to(socketPath); fd >= 0) {
+		::close(fd);
+		throw std::runtime_error(std::format("{0}: a server is already running there", socketPath));
+	}
+
+	::unlink(socketPath.c_str());
+
+	socket_fd listener(::socket(AF_UNIX, SOCK_STREAM, 0));
+
+	if (listener.get() < 0)
+		throw std::runtime_error(std::format("{0}: couldn't create socket", socketPath));
+
+	// links can read and write anything the user can, so nobody else gets to ask for them
+	// (the socket is made with these permissions, rather than changed after, when others could already connect)
+
+	const mode_t previousMask = ::umask(S_IXUSR | S_IRWXG | S_IRWXO);
+	const bool isBound = ::bind(listener.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+	::umask(previousMask);
+
+	if (!isBound)
+		throw std::runtime_error(std::format("{0}: couldn't bind socket", socketPath));
+
+	if (::listen(listener.get(), 16) != 0) {
+		::unlink(socketPath.c_str());
+		throw std::runtime_error(std::format("{0}: couldn't listen on socket", socketPath));
+	}
+
+	// no SA_RESTART, so that accept gets interrupted
+
+	struct sigaction action {};
+	action.sa_handler = request_stop;
+	sigemptyset(&action.sa_mask);
+
+	::sigaction(SIGINT, &action, nullptr);
+	::sigaction(SIGTERM, &action, nullptr);
+
+	// links being run, which are waited for before returning (as they use the handler)
+
+	std::mutex clientMutex;
+	std::condition_variable clientDone;
+	unsigned clientCount = 0;
+
+	// (client threads leave the signals to this one, so that they interrupt accept)
+
+	sigset_t stopSignals, previousSignals;
+	sigemptyset(&stopSignals);
+	sigaddset(&stopSignals, SIGINT);
+	sigaddset(&stopSignals, SIGTERM);
+
+	while (!gStopRequested) {
+		int client = ::accept(listener.get(), nullptr, nullptr);
+
+		if (client < 0)
+			continue;
+
+		std::unique_lock lock(clientMutex);
+		clientCount++;
+		lock.unlock();
+
+		::pthread_sigmask(SIG_BLOCK, &stopSignals, &previousSignals);
+
+		try {
+			std::thread([client, &handler, &clientMutex, &clientDone, &clientCount] () {
+				serve_client(client, handler);
+
+				std::lock_guard lock(clientMutex);
+				clientCount--;
+				clientDone.notify_all();
+			}).detach();
+		} catch (const std::system_error&) {
+			// (out of threads, the client then links on its own)
+
+			::close(client);
+
+			lock.lock();
+			clientCount--;
+			lock.unlock();
+		}
+
+		::pthread_sigmask(SIG_SETMASK, &previousSignals, nullptr);
+	}
+
+	std::unique_lock lock(clientMutex);
+	clientDone.wait(lock, [&clientCount] { return clientCount == 0; });
+	lock.unlock();
+
+	::unlink(socketPath.c_str());
+}
+
+std::optional<link_response> request_link(const std::string& socketPath, const link_request& request) {
+	socket_fd server(connect_to(socketPath));
+
+	if (server.get() < 0)
+		return std::nullopt;
+
+	std::string message;
+
+	put_word(message, MAGIC);
+	put_string(message, PROJECT_VERSION);
+	put_string(message, request.workingDirectory);
+	put_word(message, request.arguments.size());
+
+	for (auto& argument : request.arguments)
+		put_string(message, argument);
+
+	put_string(message, request.cacheDirectory);
+	put_word(message, static_cast<std::uint32_t>(request.cacheSize));
+	put_word(message, static_cast<std::uint32_t>(request.cacheSize >> 32));
+	put_string(message, request.jobserverFifo);
+
+	if (!send_all(server.get(), message))
+		return std::nullopt;
+
+	link_response response;
+	std::uint32_t status, exitCode;
+
+	if (!get_word(server.get(), status) || status != STATUS_DONE || !get_word(server.get(), exitCode)
+		|| !get_string(server.get(), response.output, MAX_RESPONSE_STRING)
+		|| !get_string(server.get(), response.errors, MAX_RESPONSE_STRING))
+		return std::nullopt;
+
+	response.exitCode = static_cast<int>(exitCode);
+	return response;
+}
+
+#else // _WIN32
+
+void serve_links(const std::string&, const link_handler&) {
+	throw std::runtime_error("lyn serve needs unix domain sockets, which this build doesn't have");
+}
+
+std::optional<link_response> request_link(const std::string&, const link_request&) {
+	return std::nullopt;
+}
+
+#endif // _WIN32
+
+} // namespace lyn
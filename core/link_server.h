@@ -0,0 +1,65 @@
+#ifndef LINK_SERVER_H
+#define LINK_SERVER_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief local socket protocol of `lyn serve`
+ *
+ * A client sends the arguments of a link, its working directory and what its
+ * environment says about caching and the jobserver, the server runs the link
+ * and sends back its exit code and what it printed. Each client is served on
+ * a thread of its own, so links given at the same time (as by `make -j`) run
+ * at the same time.
+ *
+ * Messages are little endian words and strings (a size, then characters):
+ *   request:  magic, lyn version, working directory, argument count, arguments,
+ *             cache directory, cache size (low word, high word), jobserver fifo
+ *   response: status, exit code, output, errors
+ *
+ * Servers refuse requests from other versions of lyn (as they would link
+ * differently), clients then link on their own.
+ *
+ * This needs unix domain sockets, which windows builds go without.
+ *
+ */
+struct link_request {
+	std::string workingDirectory;
+	std::vector<std::string> arguments;
+
+	// (the server goes by these rather than by its own environment)
+
+	std::string cacheDirectory; // see lyn::cache_directory (empty if the client has nowhere to cache things)
+	std::uint64_t cacheSize = 0; // see content_cache::default_max_size
+	std::string jobserverFifo; // see jobserver::fifo_path (empty if the client has no jobserver)
+};
+
+struct link_response {
+	int exitCode = 0;
+
+	std::string output;
+	std::string errors;
+};
+
+using link_handler = std::function<link_response(const link_request&)>;
+
+/* socket used when none is given: $LYN_SERVER, or server.sock in the cache directory (empty if there is neither) */
+std::string default_server_socket();
+
+/* serves links until interrupted (by SIGINT or SIGTERM), then waits for those being run and removes the socket
+ * the handler is called from several threads at once
+ * throws if the socket can't be set up, or if another server is already there */
+void serve_links(const std::string& socketPath, const link_handler& handler);
+
+/* has a server run a link, nullopt if there's no server (or it refused or dropped the request) */
+std::optional<link_response> request_link(const std::string& socketPath, const link_request& request);
+
+} // namespace lyn
+
+#endif // LINK_SERVER_H
@@ -0,0 +1,64 @@
+#include "mapped_file.h"
+
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace lyn {
+
+mapped_file::mapped_file(const std::string& fileName)
+	: mFileName(fileName) {
+#ifndef _WIN32
+	int fd = ::open(mFileName.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		throw std::runtime_error(std::format("Couldn't open file for read: {0}", mFileName));
+
+	struct stat status {};
+
+	if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+		void* mapping = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (mapping != MAP_FAILED) {
+			mData = static_cast<const std::uint8_t*>(mapping);
+			mSize = status.st_size;
+			mMapped = true;
+		}
+	}
+
+	::close(fd);
+
+	if (mMapped || status.st_size == 0)
+		return;
+#endif
+
+	std::ifstream input(mFileName, std::ios::in | std::ios::binary);
+
+	if (!input.is_open())
+		throw std::runtime_error(std::format("Couldn't open file for read: {0}", mFileName));
+
+	input.seekg(0, std::ios::end);
+	mFallback.resize(input.tellg());
+
+	input.seekg(0);
+	input.read(reinterpret_cast<char*>(mFallback.data()), mFallback.size());
+
+	mData = mFallback.data();
+	mSize = mFallback.size();
+}
+
+mapped_file::~mapped_file() {
+#ifndef _WIN32
+	if (mMapped)
+		::munmap(const_cast<std::uint8_t*>(mData), mSize);
+#endif
+}
+
+} // namespace lyn
@@ -0,0 +1,45 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief read-only view of a whole file, memory-mapped when the platform allows it
+ *
+ * Unlike lyn::data_file, this doesn't copy the file into memory, which matters
+ * for big inputs (such as ROMs) that are only partially looked at.
+ *
+ */
+class mapped_file {
+public:
+	mapped_file(const std::string& fileName);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator = (const mapped_file&) = delete;
+
+	const std::uint8_t* data() const { return mData; }
+	std::size_t size() const { return mSize; }
+
+	std::span<const std::uint8_t> bytes() const { return { mData, mSize }; }
+
+	const std::string& file_name() const { return mFileName; }
+
+private:
+	std::string mFileName;
+
+	const std::uint8_t* mData = nullptr;
+	std::size_t mSize = 0;
+
+	bool mMapped = false;
+	std::vector<std::uint8_t> mFallback; // when mapping isn't possible
+};
+
+} // namespace lyn
+
+#endif // MAPPED_FILE_H
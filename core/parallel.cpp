@@ -0,0 +1,145 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "jobserver.h"
+
+namespace lyn {
+
+namespace {
+
+std::atomic<unsigned> gThreadLimit = 0;
+
+thread_local bool tIsInParallelWork = false;
+
+// (0 to go by gThreadLimit)
+thread_local unsigned tThreadLimit = 0;
+
+// (only if tHasJobserver, the jobserver of the environment otherwise)
+thread_local jobserver* tJobserver = nullptr;
+thread_local bool tHasJobserver = false;
+
+unsigned thread_limit() {
+	return tThreadLimit != 0 ? tThreadLimit : gThreadLimit.load();
+}
+
+unsigned hardware_thread_count() {
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+} // namespace
+
+void set_thread_limit(unsigned count) {
+	gThreadLimit = count;
+}
+
+scoped_thread_limit::scoped_thread_limit(unsigned count) : mPrevious(tThreadLimit) {
+	if (count != 0)
+		tThreadLimit = count;
+}
+
+scoped_thread_limit::~scoped_thread_limit() {
+	tThreadLimit = mPrevious;
+}
+
+scoped_jobserver::scoped_jobserver(jobserver* tokens) : mPrevious(tJobserver), mHadPrevious(tHasJobserver) {
+	tJobserver = tokens;
+	tHasJobserver = true;
+}
+
+scoped_jobserver::~scoped_jobserver() {
+	tJobserver = mPrevious;
+	tHasJobserver = mHadPrevious;
+}
+
+bool can_run_parallel() {
+	if (tIsInParallelWork)
+		return false;
+
+	if (unsigned limit = thread_limit())
+		return limit > 1;
+
+	// with a jobserver, tokens may or may not be there when the work starts, but there's no point if it can never have any
+
+	return hardware_thread_count() > 1;
+}
+
+void parallel_for(std::size_t count, const std::function<void(std::size_t)>& work) {
+	std::atomic<std::size_t> next = 0;
+
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto run = [&] () {
+		const bool wasInParallelWork = tIsInParallelWork;
+		tIsInParallelWork = true;
+
+		for (std::size_t i = next++; i < count; i = next++) {
+			try {
+				work(i);
+			} catch (...) {
+				std::lock_guard lock(errorMutex);
+
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+
+		tIsInParallelWork = wasInParallelWork;
+	};
+
+	// -j wins over the jobserver, which is only there to share the machine with other jobs when nothing else says how
+
+	std::size_t extraThreads = 0;
+	jobserver* tokens = nullptr;
+
+	if (can_run_parallel() && count > 1) {
+		unsigned limit = thread_limit();
+
+		if (limit == 0) {
+			limit = hardware_thread_count();
+			tokens = tHasJobserver ? tJobserver : jobserver::from_environment();
+		}
+
+		extraThreads = std::min<std::size_t>(limit, count) - 1;
+	}
+
+	std::vector<std::thread> threads;
+
+	for (std::size_t i = 0; i < extraThreads; ++i) {
+		if (tokens && !tokens->try_acquire())
+			break;
+
+		try {
+			threads.emplace_back([&run, tokens] () {
+				run();
+
+				if (tokens)
+					tokens->release();
+			});
+		} catch (const std::system_error&) {
+			// (out of threads, the ones there are will do)
+
+			if (tokens)
+				tokens->release();
+
+			break;
+		}
+	}
+
+	run();
+
+	for (auto& thread : threads)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+} // namespace lyn
@@ -0,0 +1,56 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace lyn {
+
+class jobserver;
+
+/* sets how many threads parallel_for may use at most (from -j)
+ * 0 (the default) goes by the make jobserver when lyn is run by one, and by the hardware concurrency otherwise */
+void set_thread_limit(unsigned count);
+
+/* limits how many threads parallel_for may use when called from this thread, for as long as it lives (0 changes nothing)
+ * this wins over set_thread_limit, so that the -j of one of several links run by the same process only goes for that link */
+class scoped_thread_limit {
+public:
+	explicit scoped_thread_limit(unsigned count);
+	~scoped_thread_limit();
+
+	scoped_thread_limit(const scoped_thread_limit&) = delete;
+	scoped_thread_limit& operator = (const scoped_thread_limit&) = delete;
+
+private:
+	unsigned mPrevious;
+};
+
+/* has parallel_for take its tokens from this jobserver (nullptr for none) rather than the one of the environment, when called from this thread
+ * for as long as this lives, so that lyn serve can go by the jobserver of the client it links for */
+class scoped_jobserver {
+public:
+	explicit scoped_jobserver(jobserver* tokens);
+	~scoped_jobserver();
+
+	scoped_jobserver(const scoped_jobserver&) = delete;
+	scoped_jobserver& operator = (const scoped_jobserver&) = delete;
+
+private:
+	jobserver* mPrevious;
+	bool mHadPrevious;
+};
+
+/* whether parallel_for may use more than one thread
+ * this is false within parallel work, so that it isn't split any further */
+bool can_run_parallel();
+
+/* runs work(i) for every i in [0, count), on several threads when it can (the calling one included)
+ * with a jobserver, each thread on top of the calling one holds one of its tokens, so there are only as many as there were tokens
+ * items are handed out one at a time, so that threads that got quick ones take more
+ * if some work throws, the other items still run, and the first exception is rethrown once all are done */
+void parallel_for(std::size_t count, const std::function<void(std::size_t)>& work);
+
+} // namespace lyn
+
+#endif // PARALLEL_H
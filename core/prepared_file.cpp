@@ -0,0 +1,97 @@
+#include "prepared_file.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include "file_cache.h"
+
+namespace lyn {
+
+namespace {
+
+constexpr std::string_view MAGIC = "LYNPREP\x1A";
+constexpr std::uint32_t VERSION = 1;
+
+constexpr std::size_t ARRAY_ALIGN = 8;
+
+} // namespace
+
+prepared_writer::prepared_writer() {
+	mData.resize(MAGIC.size());
+	std::copy(MAGIC.begin(), MAGIC.end(), mData.begin());
+
+	put_word(VERSION);
+}
+
+void prepared_writer::put_word(std::uint32_t value) {
+	std::size_t offset = mData.size();
+
+	mData.resize(offset + 4);
+	store_le<std::uint32_t>(mData.data() + offset, value);
+}
+
+void prepared_writer::write(const std::string& fileName) const {
+	replace_file(fileName, mData);
+}
+
+void prepared_writer::align() {
+	mData.resize((mData.size() + ARRAY_ALIGN - 1) & ~(ARRAY_ALIGN - 1));
+}
+
+prepared_reader::prepared_reader(std::string_view fileName, std::span<const std::uint8_t> data)
+	: mFileName(fileName), mData(data) {
+	if (data.size() < MAGIC.size() + 4 || std::string_view(reinterpret_cast<const char*>(data.data()), MAGIC.size()) != MAGIC)
+		fail("not a prepared object");
+
+	mOffset = MAGIC.size();
+
+	if (std::uint32_t version = word(); version != VERSION)
+		fail(std::format("prepared object version {0} isn't supported (prepare it again with this lyn)", version));
+}
+
+bool prepared_reader::is_prepared_file(const std::string& fileName) {
+	std::ifstream input(fileName, std::ios::in | std::ios::binary);
+
+	char magic[MAGIC.size()] {};
+	input.read(magic, sizeof(magic));
+
+	return std::string_view(magic, input.gcount()) == MAGIC;
+}
+
+std::uint32_t prepared_reader::word() {
+	if (mData.size() - mOffset < 4)
+		fail("truncated prepared object");
+
+	std::uint32_t result = load_le<std::uint32_t>(mData.data() + mOffset);
+	mOffset += 4;
+
+	return result;
+}
+
+std::string_view prepared_reader::chars(std::size_t count) {
+	if (count > mData.size() - mOffset)
+		fail("truncated prepared object");
+
+	auto bytes = take_array(count);
+	return std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void prepared_reader::fail(std::string_view what) const {
+	throw std::runtime_error(std::format("{0}: {1}", mFileName, what));
+}
+
+std::span<const std::uint8_t> prepared_reader::take_array(std::size_t size) {
+	// the padding the writer put before the array (which the end of the file may be short of, if the array is empty)
+
+	std::size_t begin = std::min((mOffset + ARRAY_ALIGN - 1) & ~(ARRAY_ALIGN - 1), mData.size());
+
+	if (size > mData.size() - begin)
+		fail("truncated prepared object");
+
+	mOffset = begin + size;
+	return mData.subspan(begin, size);
+}
+
+} // namespace lyn
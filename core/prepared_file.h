@@ -0,0 +1,125 @@
+#ifndef PREPARED_FILE_H
+#define PREPARED_FILE_H
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "data_chunk.h"
+
+namespace lyn {
+
+/*!
+ * \brief flat storage of prepared objects (.lyo files, made with `lyn prep`)
+ *
+ * A prepared object is what lyn gets out of loading an ELF object, written as
+ * a sequence of words and arrays (all little endian). Arrays are stored as
+ * they are in memory and aligned to 8 bytes, so reading one back is a bounds
+ * check and a copy rather than decoding anything.
+ *
+ * The layout itself is up to lyn::event_object, which writes and reads them.
+ * Files start with a magic and a version, objects prepared by another
+ * version of the format are rejected (they need to be prepared again).
+ *
+ */
+class prepared_writer {
+public:
+	prepared_writer();
+
+	void put_word(std::uint32_t value);
+
+	template<typename T>
+	void put_array(std::span<const T> values);
+
+	/* just the characters, the size has to be written before (with put_word) */
+	void put_chars(std::string_view chars) {
+		put_array(std::span<const char>(chars.data(), chars.size()));
+	}
+
+	std::span<const std::uint8_t> bytes() const { return mData; }
+	std::vector<std::uint8_t> take_bytes() && { return std::move(mData); }
+
+	/* writes to a temporary first, so that a link mapping the file never sees it half written */
+	void write(const std::string& fileName) const;
+
+private:
+	void align();
+
+	std::vector<std::uint8_t> mData;
+};
+
+class prepared_reader {
+public:
+	/* checks the magic and version, throws if they aren't right */
+	prepared_reader(std::string_view fileName, std::span<const std::uint8_t> data);
+
+	/* whether the file starts like a prepared object (this only reads the magic) */
+	static bool is_prepared_file(const std::string& fileName);
+
+	std::uint32_t word();
+
+	/* reads count values into out (which is resized to fit) */
+	template<typename T, typename Container>
+	void array(Container& out, std::size_t count);
+
+	std::string_view chars(std::size_t count);
+
+	bool at_end() const { return mOffset == mData.size(); }
+
+	[[noreturn]] void fail(std::string_view what) const;
+
+private:
+	std::span<const std::uint8_t> take_array(std::size_t size);
+
+	std::string_view mFileName;
+	std::span<const std::uint8_t> mData;
+	std::size_t mOffset = 0;
+};
+
+template<typename T>
+void prepared_writer::put_array(std::span<const T> values) {
+	static_assert(std::is_integral_v<T>);
+
+	align();
+
+	std::size_t offset = mData.size();
+	mData.resize(offset + values.size_bytes());
+
+	if constexpr (std::endian::native == std::endian::little) {
+		if (!values.empty())
+			std::memcpy(mData.data() + offset, values.data(), values.size_bytes());
+	} else {
+		for (auto value : values) {
+			store_le<T>(mData.data() + offset, value);
+			offset += sizeof(T);
+		}
+	}
+}
+
+template<typename T, typename Container>
+void prepared_reader::array(Container& out, std::size_t count) {
+	static_assert(std::is_integral_v<T> && sizeof(typename Container::value_type) == sizeof(T));
+
+	if (count > (mData.size() - mOffset) / sizeof(T))
+		fail("truncated prepared object");
+
+	auto bytes = take_array(count * sizeof(T));
+
+	out.resize(count);
+
+	if constexpr (std::endian::native == std::endian::little) {
+		if (count != 0)
+			std::memcpy(out.data(), bytes.data(), bytes.size());
+	} else {
+		for (std::size_t i = 0; i < count; ++i)
+			out[i] = static_cast<typename Container::value_type>(load_le<T>(bytes.data() + i * sizeof(T)));
+	}
+}
+
+} // namespace lyn
+
+#endif // PREPARED_FILE_H
@@ -0,0 +1,162 @@
+#include "region_allocator.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include "text_parse.h"
+
+namespace lyn {
+
+void region_allocator::load_from_file(const char* fileName) {
+	std::ifstream input(fileName);
+
+	if (!input.is_open())
+		throw std::runtime_error(std::format("Couldn't open region file for read: {0}", fileName));
+
+	std::string line;
+	unsigned lineNumber = 0;
+
+	while (std::getline(input, line)) {
+		lineNumber++;
+
+		auto fields = split_config_line(line);
+
+		if (fields.empty())
+			continue;
+
+		unsigned long long start = 0, size = 0, align = 4;
+
+		if (fields.size() < 3 || fields.size() > 4
+			|| !parse_config_number(fields[1], start)
+			|| !parse_config_number(fields[2], size)
+			|| (fields.size() == 4 && !parse_config_number(fields[3], align)))
+		{
+			throw std::runtime_error(std::format("{0}:{1}: expected `<name> <start> <size> [<alignment>]`", fileName, lineNumber));
+		}
+
+		if (start >= 0x08000000 && start < 0x0A000000)
+			start -= 0x08000000;
+
+		if (start + size > 0x02000000)
+			throw std::runtime_error(std::format("{0}:{1}: region `{2}` does not fit in ROM", fileName, lineNumber, fields[0]));
+
+		if (align == 0 || (align & (align - 1)) != 0)
+			throw std::runtime_error(std::format("{0}:{1}: region alignment must be a power of two", fileName, lineNumber));
+
+		try {
+			add_region(fields[0], start, size, align);
+		} catch (const std::runtime_error& e) {
+			throw std::runtime_error(std::format("{0}:{1}: {2}", fileName, lineNumber, e.what()));
+		}
+	}
+}
+
+void region_allocator::add_region(const std::string& name, unsigned start, unsigned size, unsigned align) {
+	if (align < 4)
+		align = 4;
+
+	// sections are placed in regions independently, so regions sharing bytes would get several sections on the same bytes
+
+	for (auto& region : mRegions) {
+		if (start < region.start + region.size && region.start < start + size) {
+			throw std::runtime_error(std::format("region `{0}` (${1:06X}-${2:06X}) overlaps region `{3}` (${4:06X}-${5:06X})",
+				name, start, start + size, region.name, region.start, region.start + region.size));
+		}
+	}
+
+	mRegions.push_back({ name, start, size, align, 0, 0 });
+}
+
+void region_allocator::add_free_space(unsigned start, unsigned size, unsigned align, unsigned minSize) {
+	std::vector<std::pair<unsigned, unsigned>> taken; // [start, end) of each region, by start
+
+	for (auto& region : mRegions)
+		taken.emplace_back(region.start, region.start + region.size);
+
+	std::sort(taken.begin(), taken.end());
+
+	auto addPart = [&] (unsigned partStart, unsigned partEnd) {
+		unsigned alignedStart = partStart;
+
+		if (unsigned misalign = (alignedStart % align))
+			alignedStart += align - misalign;
+
+		if (alignedStart < partEnd && partEnd - alignedStart >= minSize)
+			add_region(std::format("free_{0:06X}", partStart), partStart, partEnd - partStart, align);
+	};
+
+	const unsigned end = start + size;
+	unsigned cursor = start;
+
+	for (auto [takenStart, takenEnd] : taken) {
+		if (takenEnd <= cursor || takenStart >= end)
+			continue;
+
+		if (takenStart > cursor)
+			addPart(cursor, takenStart);
+
+		cursor = takenEnd;
+
+		if (cursor >= end)
+			return;
+	}
+
+	addPart(cursor, end);
+}
+
+std::optional<unsigned> region_allocator::allocate(unsigned size) {
+	region* best = nullptr;
+	unsigned bestLeftover = 0;
+
+	for (auto& region : mRegions) {
+		unsigned cursor = region.start + region.used;
+
+		if (unsigned misalign = (cursor % region.align))
+			cursor += region.align - misalign;
+
+		unsigned end = region.start + region.size;
+
+		if (cursor > end || (end - cursor) < size)
+			continue;
+
+		unsigned leftover = (end - cursor) - size;
+
+		if (!best || leftover < bestLeftover) {
+			best = &region;
+			bestLeftover = leftover;
+		}
+	}
+
+	if (!best)
+		return std::nullopt;
+
+	unsigned cursor = best->start + best->size - bestLeftover - size;
+
+	best->used = (cursor + size) - best->start;
+	best->allocated += size;
+
+	return cursor;
+}
+
+void region_allocator::write_report(std::ostream& output) const {
+	output << "# lyn region report" << std::endl;
+	output << "# start   size     used     free     usage  region" << std::endl;
+
+	unsigned totalSize = 0, totalAllocated = 0;
+
+	for (auto& region : mRegions) {
+		output << std::format("${0:06X}  ${1:06X}  ${2:06X}  ${3:06X}  {4:5.1f}% {5}",
+			region.start, region.size, region.allocated, region.size - region.used,
+			region.size ? (100.0 * region.allocated / region.size) : 0.0, region.name) << std::endl;
+
+		totalSize += region.size;
+		totalAllocated += region.allocated;
+	}
+
+	output << std::format("# total: ${0:X} out of ${1:X} bytes used ({2:.1f}%)",
+		totalAllocated, totalSize, totalSize ? (100.0 * totalAllocated / totalSize) : 0.0) << std::endl;
+}
+
+} // namespace lyn
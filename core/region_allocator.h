@@ -0,0 +1,61 @@
+#ifndef REGION_ALLOCATOR_H
+#define REGION_ALLOCATOR_H
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief distributes data across several free ROM regions
+ *
+ * Regions are read from a plain text file with one region per line:
+ *
+ *     <name> <start> <size> [<alignment>]
+ *
+ * Start and size can be decimal or hexadecimal (`0x` or `$` prefix). Start can
+ * be given either as a ROM offset or as a GBA address (0x08000000-based).
+ * Alignment defaults (and is raised) to 4, as this is what lyn sections need.
+ *
+ */
+class region_allocator {
+public:
+	struct region {
+		std::string name;
+
+		unsigned start;
+		unsigned size;
+		unsigned align;
+
+		unsigned used; // bytes up to the allocation cursor (including padding)
+		unsigned allocated; // bytes actually allocated (excluding padding)
+	};
+
+public:
+	void load_from_file(const char* fileName);
+
+	/* throws if the region overlaps one already added */
+	void add_region(const std::string& name, unsigned start, unsigned size, unsigned align);
+
+	/* adds the parts of this space that aren't covered by a region yet, as regions named after where they start (`free_<offset>`)
+	 * parts that are smaller than minSize once aligned are left out */
+	void add_free_space(unsigned start, unsigned size, unsigned align, unsigned minSize);
+
+	/* best fit: picks the region in which the allocation leaves the least space left over
+	 * returns the ROM offset of the allocation, or nothing if no region can hold it */
+
+	std::optional<unsigned> allocate(unsigned size);
+
+	void write_report(std::ostream& output) const;
+
+	const std::vector<region>& regions() const { return mRegions; }
+
+private:
+	std::vector<region> mRegions;
+};
+
+} // namespace lyn
+
+#endif // REGION_ALLOCATOR_H
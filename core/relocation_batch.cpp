@@ -0,0 +1,85 @@
+#include "relocation_batch.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <stdexcept>
+
+#include "arm_relocator.h"
+
+#include "elfcpp/elfcpp.h"
+#include "elfcpp/arm.h"
+
+namespace lyn {
+
+void sort_resolved_relocations(std::vector<resolved_relocation>& relocations) {
+	if (relocations.size() < 2)
+		return;
+
+	std::vector<resolved_relocation> buffer(relocations.size());
+
+	// LSD radix sort: one 8-bit pass per significant byte of offset, then one pass on type
+	// each pass is a stable counting sort, so the last key sorted on is the primary key
+
+	auto pass = [&relocations, &buffer] (auto getDigit) {
+		std::array<unsigned, 0x101> counts {};
+
+		for (auto& relocation : relocations)
+			counts[getDigit(relocation) + 1]++;
+
+		for (unsigned i = 1; i < counts.size(); ++i)
+			counts[i] += counts[i - 1];
+
+		for (auto& relocation : relocations)
+			buffer[counts[getDigit(relocation)]++] = relocation;
+
+		relocations.swap(buffer);
+	};
+
+	unsigned maxOffset = 0;
+
+	for (auto& relocation : relocations)
+		maxOffset = std::max(maxOffset, relocation.offset);
+
+	for (unsigned shift = 0; shift < 32 && (shift == 0 || (maxOffset >> shift) != 0); shift += 8)
+		pass([shift] (const resolved_relocation& r) -> unsigned { return (r.offset >> shift) & 0xFF; });
+
+	pass([] (const resolved_relocation& r) -> unsigned { return r.type & 0xFF; });
+}
+
+void apply_resolved_relocations(section_data& section, std::vector<resolved_relocation>& relocations) {
+	sort_resolved_relocations(relocations);
+
+	auto it = relocations.begin();
+
+	while (it != relocations.end()) {
+		auto groupEnd = it;
+
+		while (groupEnd != relocations.end() && groupEnd->type == it->type)
+			++groupEnd;
+
+		const unsigned type = it->type;
+		auto descriptor = arm_relocator::get_descriptor(type);
+
+		if (!descriptor)
+			throw std::runtime_error(std::format("unhandled relocation type #{0}", type));
+
+		if (type == elfcpp::R_ARM_ABS32) {
+			// group is sorted by offset: checking the range of the last one checks them all
+
+			auto bytes = section.bytes(0, (groupEnd - 1)->offset + 4);
+
+			for (; it != groupEnd; ++it) {
+				std::uint8_t* data = bytes.data() + it->offset;
+				store_le<std::uint32_t>(data, load_le<std::uint32_t>(data) + it->value + it->addend);
+			}
+		} else {
+			for (; it != groupEnd; ++it)
+				descriptor->apply_relocation(section, it->offset, it->value, it->addend);
+		}
+	}
+
+	relocations.clear();
+}
+
+} // namespace lyn
@@ -0,0 +1,31 @@
+#ifndef RELOCATION_BATCH_H
+#define RELOCATION_BATCH_H
+
+#include <vector>
+
+#include "section_data.h"
+
+namespace lyn {
+
+/* a relocation whose target value has been resolved, waiting to be applied */
+
+struct resolved_relocation {
+	unsigned offset;
+	unsigned type;
+	unsigned value;
+	int addend;
+};
+
+/* sorts relocations by type then offset (this is a radix sort, as offsets are small integers) */
+
+void sort_resolved_relocations(std::vector<resolved_relocation>& relocations);
+
+/* applies a batch of resolved relocations to a section
+ * relocations are sorted and applied one type at a time, so that dispatch happens once per type
+ * and the common case of tables of pointers (R_ARM_ABS32) runs as a tight loop */
+
+void apply_resolved_relocations(section_data& section, std::vector<resolved_relocation>& relocations);
+
+} // namespace lyn
+
+#endif // RELOCATION_BATCH_H
@@ -1,28 +1,121 @@
 #include "section_data.h"
 
 #include <algorithm>
+#include <iterator>
+#include <numeric>
 
 namespace lyn {
 
+template<typename T>
+static void apply_permutation(std::pmr::vector<T>& values, const std::vector<std::size_t>& order) {
+	std::pmr::vector<T> result(values.get_allocator());
+	result.reserve(values.size());
+
+	for (auto index : order)
+		result.push_back(values[index]);
+
+	values = std::move(result);
+}
+
+static std::vector<std::size_t> stable_order_by(const std::pmr::vector<unsigned>& keys) {
+	std::vector<std::size_t> order(keys.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	std::stable_sort(order.begin(), order.end(), [&keys] (std::size_t a, std::size_t b) -> bool {
+		return keys[a] < keys[b];
+	});
+
+	return order;
+}
+
+void section_data::relocation_table::push_back(name_id symbol, int addend, unsigned type, unsigned offset) {
+	offsets.push_back(offset);
+	types.push_back(type);
+	addends.push_back(addend);
+	symbols.push_back(symbol);
+}
+
+void section_data::relocation_table::reserve(std::size_t count) {
+	offsets.reserve(count);
+	types.reserve(count);
+	addends.reserve(count);
+	symbols.reserve(count);
+}
+
+void section_data::relocation_table::stable_sort_by_offset() {
+	if (std::is_sorted(offsets.begin(), offsets.end()))
+		return;
+
+	auto order = stable_order_by(offsets);
+
+	apply_permutation(offsets, order);
+	apply_permutation(types, order);
+	apply_permutation(addends, order);
+	apply_permutation(symbols, order);
+}
+
+void section_data::symbol_table::push_back(name_id name, unsigned offset, unsigned size, bool isLocal, bool isFunction) {
+	names.push_back(name);
+	offsets.push_back(offset);
+	sizes.push_back(size);
+	flags.push_back((isLocal ? Local : 0) | (isFunction ? Function : 0));
+}
+
+void section_data::symbol_table::reserve(std::size_t count) {
+	names.reserve(count);
+	offsets.reserve(count);
+	sizes.reserve(count);
+	flags.reserve(count);
+}
+
+void section_data::symbol_table::stable_sort_by_offset() {
+	if (std::is_sorted(offsets.begin(), offsets.end()))
+		return;
+
+	auto order = stable_order_by(offsets);
+
+	apply_permutation(names, order);
+	apply_permutation(offsets, order);
+	apply_permutation(sizes, order);
+	apply_permutation(flags, order);
+}
+
+static bool mapping_offset_less(const section_data::mapping& left, const section_data::mapping& right) {
+	return left.offset < right.offset;
+}
+
 int section_data::mapping_type_at(unsigned int offset) const {
-	for (auto mapping : mMappings)
-		if (mapping.offset <= offset)
-			return mapping.type;
+	// the mapping covering offset is the last one starting at or before it
 
-	return mapping::Data;
+	auto it = std::upper_bound(mMappings.begin(), mMappings.end(), mapping { mapping::Data, offset }, mapping_offset_less);
+
+	if (it == mMappings.begin())
+		return mapping::Data;
+
+	return std::prev(it)->type;
 }
 
 void section_data::set_mapping(unsigned int offset, mapping::type_enum type) {
-	for (auto& mapping : mMappings)
-		if (mapping.offset == offset) {
-			mapping.type = type;
-			return;
-		}
-	mMappings.push_back({ type, offset });
-
-	std::sort(mMappings.begin(), mMappings.end(), [] (const mapping& left, const mapping& right) {
-		return left.offset < right.offset;
-	});
+	auto it = std::lower_bound(mMappings.begin(), mMappings.end(), mapping { type, offset }, mapping_offset_less);
+
+	if (it != mMappings.end() && it->offset == offset)
+		it->type = type;
+	else
+		mMappings.insert(it, { type, offset });
+}
+
+void section_data::set_mappings(std::vector<mapping>&& mappings) {
+	std::stable_sort(mappings.begin(), mappings.end(), mapping_offset_less);
+
+	mMappings.clear();
+	mMappings.reserve(mappings.size());
+
+	for (auto& mapping : mappings) {
+		if (!mMappings.empty() && mMappings.back().offset == mapping.offset)
+			mMappings.back().type = mapping.type;
+		else
+			mMappings.push_back(mapping);
+	}
 }
 
 } // namespace lyn
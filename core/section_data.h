@@ -1,9 +1,16 @@
 #ifndef SECTION_DATA_H
 #define SECTION_DATA_H
 
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "data_chunk.h"
+#include "string_pool.h"
+#include "symbol_ref.h"
 
 namespace lyn {
 
@@ -19,42 +26,199 @@ struct section_data : public data_chunk {
 		unsigned offset;
 	};
 
-	struct symbol {
-		std::string name;
-		unsigned int offset;
-		bool is_local : 1;
-		bool is_function : 1;
+	/* relocations and symbols are stored as parallel arrays (one entry per index)
+	 * names are either ids into the section's string pool or, for locals, symbol_ref keys (which are all above 32 bits) */
+
+	using name_id = std::uint64_t;
+
+	struct relocation_table {
+		explicit relocation_table(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: offsets(resource), types(resource), addends(resource), symbols(resource) {}
+
+		std::pmr::vector<unsigned> offsets;
+		std::pmr::vector<unsigned> types;
+		std::pmr::vector<int> addends;
+		std::pmr::vector<name_id> symbols;
+
+		std::size_t size() const { return offsets.size(); }
+		bool empty() const { return offsets.empty(); }
+
+		void push_back(name_id symbol, int addend, unsigned type, unsigned offset);
+		void reserve(std::size_t count);
+
+		/* removes all entries for which pred(index) is true */
+		template<typename Pred>
+		void erase_if(Pred pred);
+
+		void stable_sort_by_offset();
 	};
 
-	struct relocation {
-		std::string symbolName;
-		int addend;
+	struct symbol_table {
+		enum flag_enum : std::uint8_t {
+			Local    = 1 << 0,
+			Function = 1 << 1,
+		};
 
-		unsigned type;
-		unsigned offset;
+		explicit symbol_table(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: names(resource), offsets(resource), sizes(resource), flags(resource) {}
+
+		std::pmr::vector<name_id> names;
+		std::pmr::vector<unsigned> offsets;
+		std::pmr::vector<unsigned> sizes;
+		std::pmr::vector<std::uint8_t> flags;
+
+		std::size_t size() const { return offsets.size(); }
+		bool empty() const { return offsets.empty(); }
+
+		bool is_local(std::size_t index) const { return flags[index] & Local; }
+		bool is_function(std::size_t index) const { return flags[index] & Function; }
+
+		void push_back(name_id name, unsigned offset, unsigned size, bool isLocal, bool isFunction);
+		void reserve(std::size_t count);
+
+		/* removes all entries for which pred(index) is true */
+		template<typename Pred>
+		void erase_if(Pred pred);
+
+		void stable_sort_by_offset();
 	};
 
 public:
-	void set_name(const std::string& name) { mName = name; }
-	const std::string& name() const { return mName; }
+	/* sections are allocator-aware, so that containers of sections put them in their own memory resource
+	 * copies and moves between different resources copy the contents */
+
+	using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+	section_data() = default;
+
+	explicit section_data(const allocator_type& allocator)
+		: data_chunk(allocator), mName(allocator), mNames(allocator.resource()),
+		  mRelocations(allocator.resource()), mSymbols(allocator.resource()), mMappings(allocator) {}
+
+	section_data(const section_data& other) = default;
+	section_data(section_data&& other) = default;
 
-	const std::vector<relocation>& relocations() const { return mRelocations; }
-	std::vector<relocation>& relocations() { return mRelocations; }
+	section_data(const section_data& other, const allocator_type& allocator)
+		: section_data(allocator) { *this = other; }
 
-	const std::vector<symbol>& symbols() const { return mSymbols; }
-	std::vector<symbol>& symbols() { return mSymbols; }
+	section_data(section_data&& other, const allocator_type& allocator)
+		: section_data(allocator) { *this = std::move(other); }
+
+	section_data& operator = (const section_data& other) = default;
+	section_data& operator = (section_data&& other) = default;
+
+	allocator_type get_allocator() const { return data_chunk::get_allocator(); }
+
+	void set_name(std::string_view name) { mName = name; }
+	std::string_view name() const { return mName; }
+
+	/* placed sections are output at a fixed ROM offset rather than in the stream at CURRENTOFFSET */
+	bool is_placed() const { return mAddress.has_value(); }
+	unsigned address() const { return *mAddress; }
+	void set_address(unsigned address) { mAddress = address; }
+
+	const relocation_table& relocations() const { return mRelocations; }
+	relocation_table& relocations() { return mRelocations; }
+
+	const symbol_table& symbols() const { return mSymbols; }
+	symbol_table& symbols() { return mSymbols; }
+
+	const string_pool& names() const { return mNames; }
+	string_pool& names() { return mNames; }
+
+	symbol_ref symbol_name(std::size_t index) const { return ref_of(mSymbols.names[index]); }
+	symbol_ref relocation_symbol(std::size_t index) const { return ref_of(mRelocations.symbols[index]); }
+
+	void add_symbol(symbol_ref name, unsigned offset, unsigned size, bool isLocal, bool isFunction) {
+		mSymbols.push_back(id_of(name), offset, size, isLocal, isFunction);
+	}
+
+	void add_relocation(symbol_ref symbol, int addend, unsigned type, unsigned offset) {
+		mRelocations.push_back(id_of(symbol), addend, type, offset);
+	}
+
+	void set_relocation_symbol(std::size_t index, symbol_ref symbol) {
+		mRelocations.symbols[index] = id_of(symbol);
+	}
+
+	/* mappings (from $a, $t and $d symbols) are kept sorted by offset, each covering the data up to the next one
+	 * data before the first mapping is Data */
 
 	int mapping_type_at(unsigned int offset) const;
 	void set_mapping(unsigned int offset, mapping::type_enum type);
 
+	/* replaces all mappings at once, sorting them only once (when there are several at the same offset, the last one wins) */
+	void set_mappings(std::vector<mapping>&& mappings);
+
+	const std::pmr::vector<mapping>& mappings() const { return mMappings; }
+
 private:
-	std::string mName;
+	symbol_ref ref_of(name_id id) const {
+		return (id >> 32) ? symbol_ref::local((id >> 32) - 1, id & 0xFFFFFFFF) : symbol_ref(mNames.get(id));
+	}
 
-	std::vector<relocation> mRelocations;
-	std::vector<symbol> mSymbols;
-	std::vector<mapping> mMappings;
+	name_id id_of(const symbol_ref& ref) {
+		return ref.is_local_key() ? ref.local_key() : mNames.add(ref.text());
+	}
+
+	std::pmr::string mName;
+	std::optional<unsigned> mAddress;
+
+	string_pool mNames;
+
+	relocation_table mRelocations;
+	symbol_table mSymbols;
+	std::pmr::vector<mapping> mMappings;
 };
 
+template<typename Pred>
+void section_data::relocation_table::erase_if(Pred pred) {
+	std::size_t out = 0;
+
+	for (std::size_t i = 0; i < size(); ++i) {
+		if (pred(i))
+			continue;
+
+		if (out != i) {
+			offsets[out] = offsets[i];
+			types[out] = types[i];
+			addends[out] = addends[i];
+			symbols[out] = symbols[i];
+		}
+
+		out++;
+	}
+
+	offsets.resize(out);
+	types.resize(out);
+	addends.resize(out);
+	symbols.resize(out);
+}
+
+template<typename Pred>
+void section_data::symbol_table::erase_if(Pred pred) {
+	std::size_t out = 0;
+
+	for (std::size_t i = 0; i < size(); ++i) {
+		if (pred(i))
+			continue;
+
+		if (out != i) {
+			names[out] = names[i];
+			offsets[out] = offsets[i];
+			sizes[out] = sizes[i];
+			flags[out] = flags[i];
+		}
+
+		out++;
+	}
+
+	names.resize(out);
+	offsets.resize(out);
+	sizes.resize(out);
+	flags.resize(out);
+}
+
 } // namespace lyn
 
 #endif // SECTION_DATA_H
@@ -0,0 +1,131 @@
+#include "string_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace lyn {
+
+string_pool::string_pool(std::pmr::memory_resource* resource)
+	: mResource(resource), mBlocks(resource), mStrings(resource) {}
+
+string_pool::string_pool(const string_pool& other)
+	: string_pool() {
+	*this = other;
+}
+
+string_pool::string_pool(string_pool&& other) noexcept
+	: mResource(other.mResource),
+	  mBlocks(std::move(other.mBlocks)),
+	  mCursor(std::exchange(other.mCursor, nullptr)),
+	  mBlockLeft(std::exchange(other.mBlockLeft, 0)),
+	  mNextBlockSize(std::exchange(other.mNextBlockSize, MIN_BLOCK_SIZE)),
+	  mStrings(std::move(other.mStrings)) {
+	other.mBlocks.clear();
+	other.mStrings.clear();
+}
+
+string_pool::~string_pool() {
+	release();
+}
+
+string_pool& string_pool::operator = (const string_pool& other) {
+	if (this == &other)
+		return *this;
+
+	release();
+
+	// (a copy is sized up front, as all of its strings are known)
+
+	std::size_t size = 0;
+
+	for (auto string : other.mStrings)
+		size += string.size();
+
+	reserve(other.mStrings.size(), size);
+
+	for (auto string : other.mStrings)
+		add(string);
+
+	return *this;
+}
+
+string_pool& string_pool::operator = (string_pool&& other) {
+	if (this == &other)
+		return *this;
+
+	// blocks can only change hands between pools sharing a resource
+
+	if (mResource != other.mResource && !mResource->is_equal(*other.mResource))
+		return *this = std::as_const(other);
+
+	release();
+
+	mBlocks = std::move(other.mBlocks);
+	mCursor = std::exchange(other.mCursor, nullptr);
+	mBlockLeft = std::exchange(other.mBlockLeft, 0);
+	mNextBlockSize = std::exchange(other.mNextBlockSize, MIN_BLOCK_SIZE);
+	mStrings = std::move(other.mStrings);
+
+	other.mBlocks.clear();
+	other.mStrings.clear();
+
+	return *this;
+}
+
+void string_pool::release() {
+	for (auto& block : mBlocks)
+		mResource->deallocate(block.data, block.size, 1);
+
+	mBlocks.clear();
+	mCursor = nullptr;
+	mBlockLeft = 0;
+	mNextBlockSize = MIN_BLOCK_SIZE;
+	mStrings.clear();
+}
+
+void string_pool::reserve(std::size_t count, std::size_t size) {
+	mStrings.reserve(mStrings.size() + count);
+
+	if (size > mBlockLeft) {
+		// what was left of the current block is dropped, as it wouldn't hold all of them anyway
+
+		mCursor = static_cast<char*>(mResource->allocate(size, 1));
+		mBlockLeft = size;
+
+		mBlocks.push_back({ mCursor, size });
+	}
+}
+
+unsigned string_pool::add(std::string_view string) {
+	char* data;
+
+	if (string.size() > mBlockLeft && string.size() > MAX_BLOCK_SIZE / 4) {
+		// big strings get their own block, so that they don't waste the rest of the current one
+
+		data = static_cast<char*>(mResource->allocate(string.size(), 1));
+		mBlocks.push_back({ data, string.size() });
+	} else {
+		if (string.size() > mBlockLeft) {
+			const std::size_t blockSize = std::max(mNextBlockSize, string.size());
+
+			mCursor = static_cast<char*>(mResource->allocate(blockSize, 1));
+			mBlockLeft = blockSize;
+
+			mBlocks.push_back({ mCursor, blockSize });
+
+			mNextBlockSize = std::min(blockSize * 2, MAX_BLOCK_SIZE);
+		}
+
+		data = mCursor;
+
+		mCursor += string.size();
+		mBlockLeft -= string.size();
+	}
+
+	std::copy(string.begin(), string.end(), data);
+
+	mStrings.push_back(std::string_view(data, string.size()));
+	return mStrings.size() - 1;
+}
+
+} // namespace lyn
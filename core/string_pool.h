@@ -0,0 +1,72 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief append-only store of strings, referred to by index
+ *
+ * Strings are packed into blocks rather than each having their own
+ * allocation. Blocks never move, so views returned by get() stay valid for as
+ * long as the pool lives, even as more strings are added. Blocks start small
+ * and double in size as the pool grows, as objects have many pools (one for
+ * each section) that mostly hold a few names.
+ *
+ * Blocks come from the given memory resource. Like pmr containers, copies use
+ * the default resource and assignment keeps the resource of the destination.
+ *
+ */
+class string_pool {
+public:
+	explicit string_pool(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	string_pool(const string_pool& other);
+	string_pool(string_pool&& other) noexcept;
+
+	~string_pool();
+
+	string_pool& operator = (const string_pool& other);
+	string_pool& operator = (string_pool&& other);
+
+	unsigned add(std::string_view string);
+
+	/* makes room for count more strings, of size characters in all, so that adding them doesn't allocate
+	 * (for when the strings are known up front, pools otherwise allocate blocks as they go) */
+	void reserve(std::size_t count, std::size_t size);
+
+	std::string_view get(unsigned id) const { return mStrings[id]; }
+
+	std::size_t size() const { return mStrings.size(); }
+
+	std::pmr::memory_resource* resource() const { return mResource; }
+
+private:
+	struct block {
+		char* data;
+		std::size_t size;
+	};
+
+	void release();
+
+	static constexpr std::size_t MIN_BLOCK_SIZE = 0x40;
+	static constexpr std::size_t MAX_BLOCK_SIZE = 0x1000;
+
+	std::pmr::memory_resource* mResource;
+
+	std::pmr::vector<block> mBlocks;
+
+	char* mCursor = nullptr;
+	std::size_t mBlockLeft = 0;
+
+	std::size_t mNextBlockSize = MIN_BLOCK_SIZE;
+
+	std::pmr::vector<std::string_view> mStrings;
+};
+
+} // namespace lyn
+
+#endif // STRING_POOL_H
@@ -0,0 +1,311 @@
+#include "symbol_db.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "data_chunk.h"
+#include "file_cache.h"
+#include "hash.h"
+
+namespace lyn {
+
+namespace {
+
+/* layout (all little endian):
+ *   header: magic, version, count, bucket count, seed, size of the string pool
+ *   u32 addresses[count] (sorted)
+ *   u32 sizes[count]
+ *   u32 nameOffsets[count + 1] (name i is strings[nameOffsets[i], nameOffsets[i + 1]))
+ *   u32 displacements[bucket count]
+ *   u32 slots[count] (index of the entry for each hash slot)
+ *   u8  flags[count]
+ *   char strings[] */
+
+constexpr std::string_view MAGIC = "LYNSYMDB";
+constexpr std::uint32_t VERSION = 1;
+
+constexpr std::size_t HEADER_SIZE = 8 + 5 * 4;
+
+constexpr std::uint8_t FLAG_FUNCTION = 1 << 0;
+
+// buckets of a single name point straight at their slot, rather than giving a seed for it
+constexpr std::uint32_t DIRECT_SLOT = 0x80000000;
+
+// keys of a bucket are spread with a hash of their own, seeded by the bucket's displacement
+// (this is "hash and displace", each bucket gets the first displacement that puts its keys in free slots)
+
+std::uint32_t bucket_of(std::string_view name, std::uint32_t seed, std::uint32_t bucketCount) {
+	return hash_string(name, std::uint64_t(seed) << 32) % bucketCount;
+}
+
+std::uint32_t slot_of(std::string_view name, std::uint32_t seed, std::uint32_t displacement, std::uint32_t count) {
+	if (displacement & DIRECT_SLOT)
+		return displacement & ~DIRECT_SLOT;
+
+	return hash_string(name, (std::uint64_t(seed) << 32) | (displacement + 1)) % count;
+}
+
+// finds displacements for all buckets, returns false when some bucket can't be placed with this seed
+
+bool build_hash(
+	std::span<const symbol_db::entry> entries, std::uint32_t seed, std::uint32_t bucketCount,
+	std::vector<std::uint32_t>& displacements, std::vector<std::uint32_t>& slots)
+{
+	constexpr std::uint32_t MAX_DISPLACEMENT = 0x100000;
+
+	const std::uint32_t count = entries.size();
+
+	std::vector<std::vector<std::uint32_t>> buckets(bucketCount);
+
+	for (std::uint32_t i = 0; i < count; ++i)
+		buckets[bucket_of(entries[i].name, seed, bucketCount)].push_back(i);
+
+	std::vector<std::uint32_t> order(bucketCount);
+
+	for (std::uint32_t i = 0; i < bucketCount; ++i)
+		order[i] = i;
+
+	// biggest buckets first, while there is still lots of room
+
+	std::stable_sort(order.begin(), order.end(), [&buckets] (std::uint32_t a, std::uint32_t b) {
+		return buckets[a].size() > buckets[b].size();
+	});
+
+	displacements.assign(bucketCount, 0);
+	slots.assign(count, 0);
+
+	std::vector<bool> taken(count, false);
+	std::vector<std::uint32_t> positions;
+
+	std::uint32_t nextFree = 0;
+
+	for (std::uint32_t bucket : order) {
+		auto& keys = buckets[bucket];
+
+		if (keys.empty())
+			break;
+
+		if (keys.size() == 1) {
+			while (taken[nextFree])
+				nextFree++;
+
+			taken[nextFree] = true;
+			slots[nextFree] = keys[0];
+			displacements[bucket] = DIRECT_SLOT | nextFree;
+
+			continue;
+		}
+
+		bool placed = false;
+
+		for (std::uint32_t displacement = 0; displacement < MAX_DISPLACEMENT && !placed; ++displacement) {
+			positions.clear();
+
+			for (auto key : keys) {
+				std::uint32_t slot = slot_of(entries[key].name, seed, displacement, count);
+
+				if (taken[slot] || std::find(positions.begin(), positions.end(), slot) != positions.end())
+					break;
+
+				positions.push_back(slot);
+			}
+
+			if (positions.size() != keys.size())
+				continue;
+
+			for (std::size_t i = 0; i < keys.size(); ++i) {
+				taken[positions[i]] = true;
+				slots[positions[i]] = keys[i];
+			}
+
+			displacements[bucket] = displacement;
+			placed = true;
+		}
+
+		if (!placed)
+			return false;
+	}
+
+	return true;
+}
+
+} // namespace
+
+symbol_db::symbol_db(const std::string& fileName)
+	: mFile(fileName) {
+	auto data = mFile.bytes();
+
+	if (data.size() < HEADER_SIZE || std::string_view(reinterpret_cast<const char*>(data.data()), MAGIC.size()) != MAGIC)
+		fail("not a symbol database");
+
+	if (word_at(8) != VERSION)
+		fail(std::format("unsupported symbol database version {0}", word_at(8)));
+
+	mCount       = word_at(12);
+	mBucketCount = word_at(16);
+	mSeed        = word_at(20);
+	mStringsSize = word_at(24);
+
+	if (mCount >= DIRECT_SLOT || (mCount != 0 && mBucketCount == 0))
+		fail("damaged symbol database");
+
+	mAddresses     = HEADER_SIZE;
+	mSizes         = mAddresses + std::size_t(mCount) * 4;
+	mNameOffsets   = mSizes + std::size_t(mCount) * 4;
+	mDisplacements = mNameOffsets + (std::size_t(mCount) + 1) * 4;
+	mSlots         = mDisplacements + std::size_t(mBucketCount) * 4;
+	mFlags         = mSlots + std::size_t(mCount) * 4;
+	mStrings       = mFlags + mCount;
+
+	if (mStrings + mStringsSize != data.size())
+		fail("damaged symbol database");
+}
+
+bool symbol_db::is_symbol_db_file(const std::string& fileName) {
+	std::ifstream input(fileName, std::ios::in | std::ios::binary);
+
+	char magic[MAGIC.size()] {};
+	input.read(magic, sizeof(magic));
+
+	return std::string_view(magic, input.gcount()) == MAGIC;
+}
+
+void symbol_db::write(const std::string& fileName, std::span<const entry> entries) {
+	// the first of each name is kept, then they are ordered by address
+
+	std::vector<entry> unique;
+	std::unordered_set<std::string_view> names;
+
+	for (auto& ent : entries)
+		if (names.insert(ent.name).second)
+			unique.push_back(ent);
+
+	std::stable_sort(unique.begin(), unique.end(), [] (const entry& a, const entry& b) {
+		return a.address < b.address;
+	});
+
+	if (unique.size() >= DIRECT_SLOT)
+		throw std::runtime_error(std::format("too many symbols for a symbol database ({0})", unique.size()));
+
+	const std::uint32_t count = unique.size();
+	const std::uint32_t bucketCount = count / 4 + 1;
+
+	std::vector<std::uint32_t> displacements;
+	std::vector<std::uint32_t> slots;
+
+	std::uint32_t seed = 0;
+
+	while (!build_hash(unique, seed, bucketCount, displacements, slots)) {
+		if (++seed == 0x100)
+			throw std::runtime_error("couldn't build the symbol database hash (are there duplicate names?)");
+	}
+
+	std::size_t stringsSize = 0;
+
+	for (auto& ent : unique)
+		stringsSize += ent.name.size();
+
+	if (stringsSize > 0xFFFFFFFF)
+		throw std::runtime_error("too many symbol names for a symbol database");
+
+	std::vector<std::uint8_t> data(HEADER_SIZE + std::size_t(count) * 17 + 4 + std::size_t(bucketCount) * 4 + stringsSize);
+	std::uint8_t* out = data.data();
+
+	auto put = [&out] (std::uint32_t value) {
+		store_le<std::uint32_t>(out, value);
+		out += 4;
+	};
+
+	std::copy(MAGIC.begin(), MAGIC.end(), out);
+	out += MAGIC.size();
+
+	put(VERSION);
+	put(count);
+	put(bucketCount);
+	put(seed);
+	put(stringsSize);
+
+	for (auto& ent : unique)
+		put(ent.address);
+
+	for (auto& ent : unique)
+		put(ent.size);
+
+	std::uint32_t nameOffset = 0;
+
+	for (auto& ent : unique) {
+		put(nameOffset);
+		nameOffset += ent.name.size();
+	}
+
+	put(nameOffset);
+
+	for (auto displacement : displacements)
+		put(displacement);
+
+	for (auto slot : slots)
+		put(slot);
+
+	for (auto& ent : unique)
+		*out++ = ent.isFunction ? FLAG_FUNCTION : 0;
+
+	for (auto& ent : unique)
+		out = std::copy(ent.name.begin(), ent.name.end(), out);
+
+	// the database may be mapped by a running link, so it is never written over in place
+
+	replace_file(fileName, data);
+}
+
+std::optional<std::size_t> symbol_db::find(std::string_view name) const {
+	if (mCount == 0)
+		return std::nullopt;
+
+	std::uint32_t displacement = word_at(mDisplacements + std::size_t(bucket_of(name, mSeed, mBucketCount)) * 4);
+	std::uint32_t slot = slot_of(name, mSeed, displacement, mCount);
+
+	if (slot >= mCount)
+		fail("damaged symbol database");
+
+	std::uint32_t index = word_at(mSlots + std::size_t(slot) * 4);
+
+	// the hash sends names that aren't in the database anywhere, so the name has to be checked
+
+	if (index >= mCount || at(index).name != name)
+		return std::nullopt;
+
+	return index;
+}
+
+symbol_db::entry symbol_db::at(std::size_t index) const {
+	if (index >= mCount)
+		fail(std::format("no symbol #{0} in database", index));
+
+	std::uint32_t nameBegin = word_at(mNameOffsets + index * 4);
+	std::uint32_t nameEnd = word_at(mNameOffsets + index * 4 + 4);
+
+	if (nameBegin > nameEnd || nameEnd > mStringsSize)
+		fail("damaged symbol database");
+
+	entry result;
+
+	result.name = std::string_view(reinterpret_cast<const char*>(mFile.data() + mStrings + nameBegin), nameEnd - nameBegin);
+	result.address = word_at(mAddresses + index * 4);
+	result.size = word_at(mSizes + index * 4);
+	result.isFunction = (mFile.data()[mFlags + index] & FLAG_FUNCTION) != 0;
+
+	return result;
+}
+
+std::uint32_t symbol_db::word_at(std::size_t offset) const {
+	return load_le<std::uint32_t>(mFile.data() + offset);
+}
+
+void symbol_db::fail(std::string_view what) const {
+	throw std::runtime_error(std::format("{0}: {1}", mFile.file_name(), what));
+}
+
+} // namespace lyn
@@ -0,0 +1,81 @@
+#ifndef SYMBOL_DB_H
+#define SYMBOL_DB_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace lyn {
+
+/*!
+ * \brief precompiled table of absolute symbols, looked up in place in the file
+ *
+ * Made with `lyn symdb build`, from the absolute symbols of reference
+ * objects. The file holds the symbols sorted by address (as parallel arrays
+ * of addresses, sizes, flags and name offsets in a string pool) and a
+ * minimal perfect hash of their names. Opening one only maps it, so that
+ * having lots of reference symbols doesn't cost anything until they are
+ * looked up.
+ *
+ * Entries are only checked when they are read, a damaged file gives wrong
+ * symbols or throws but never reads out of the file.
+ *
+ */
+class symbol_db {
+public:
+	struct entry {
+		std::string_view name;
+
+		unsigned address;
+		unsigned size;
+		bool isFunction;
+	};
+
+public:
+	explicit symbol_db(const std::string& fileName);
+
+	/* whether the file starts like a symbol database (this only reads the magic) */
+	static bool is_symbol_db_file(const std::string& fileName);
+
+	/* writes a database of the given entries (when names are repeated, the first entry wins) */
+	static void write(const std::string& fileName, std::span<const entry> entries);
+
+	std::size_t size() const { return mCount; }
+
+	/* index of the entry with that name, indices are in address order */
+	std::optional<std::size_t> find(std::string_view name) const;
+
+	entry at(std::size_t index) const;
+
+	const std::string& file_name() const { return mFile.file_name(); }
+
+private:
+	std::uint32_t word_at(std::size_t offset) const;
+
+	[[noreturn]] void fail(std::string_view what) const;
+
+	mapped_file mFile;
+
+	std::uint32_t mCount = 0;
+	std::uint32_t mBucketCount = 0;
+	std::uint32_t mSeed = 0;
+	std::uint32_t mStringsSize = 0;
+
+	// offsets of the arrays in the file
+	std::size_t mAddresses = 0;
+	std::size_t mSizes = 0;
+	std::size_t mNameOffsets = 0;
+	std::size_t mDisplacements = 0;
+	std::size_t mSlots = 0;
+	std::size_t mFlags = 0;
+	std::size_t mStrings = 0;
+};
+
+} // namespace lyn
+
+#endif // SYMBOL_DB_H
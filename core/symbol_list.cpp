@@ -0,0 +1,451 @@
+#include "symbol_list.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+
+namespace lyn {
+
+namespace {
+
+/* lines are read in a single pass, with one table lookup per character
+ * (this is what makes big lists fast, rather than scanning lines again for each kind of separator) */
+
+enum char_class : std::uint8_t {
+	Word,
+	Blank,     // anything at or below space
+	Separator, // `=` and `,`, which are tokens of their own
+	Comment,   // `;` and `#`
+	Slash,     // a comment when doubled, part of a word otherwise
+};
+
+constexpr auto CHAR_CLASSES = [] {
+	std::array<std::uint8_t, 256> table {};
+
+	for (unsigned c = 0; c <= ' '; ++c)
+		table[c] = Blank;
+
+	table['='] = Separator;
+	table[','] = Separator;
+	table[';'] = Comment;
+	table['#'] = Comment;
+	table['/'] = Slash;
+
+	return table;
+}();
+
+// value of each hex digit, 0xFF for other characters
+
+constexpr auto DIGIT_VALUES = [] {
+	std::array<std::uint8_t, 256> table {};
+	table.fill(0xFF);
+
+	for (unsigned c = 0; c < 10; ++c)
+		table['0' + c] = c;
+
+	for (unsigned c = 0; c < 6; ++c)
+		table['a' + c] = table['A' + c] = 10 + c;
+
+	return table;
+}();
+
+constexpr unsigned MAX_TOKENS = 12;
+
+using token_array = std::array<std::string_view, MAX_TOKENS>;
+
+char_class class_of(char c) {
+	return static_cast<char_class>(CHAR_CLASSES[static_cast<unsigned char>(c)]);
+}
+
+bool is_separator(std::string_view token, char c) {
+	return token.size() == 1 && token[0] == c;
+}
+
+// splits a line into words and separators, up to the comment
+// returns the number of tokens (or MAX_TOKENS + 1 if there are too many)
+
+unsigned tokenize(std::string_view line, token_array& tokens) {
+	const std::size_t size = line.size();
+
+	unsigned count = 0;
+	std::size_t i = 0;
+
+	while (i < size) {
+		std::size_t begin = i;
+
+		switch (class_of(line[i])) {
+
+		case Blank:
+			i++;
+			continue;
+
+		case Comment:
+			return count;
+
+		case Separator:
+			i++;
+			break;
+
+		case Slash:
+			if (i + 1 < size && line[i + 1] == '/')
+				return count;
+
+			[[fallthrough]];
+
+		case Word:
+			for (i++; i < size; i++) {
+				char_class cls = class_of(line[i]);
+
+				if (cls != Word && (cls != Slash || (i + 1 < size && line[i + 1] == '/')))
+					break;
+			}
+
+			break;
+
+		}
+
+		if (count == MAX_TOKENS)
+			return MAX_TOKENS + 1;
+
+		tokens[count++] = line.substr(begin, i - begin);
+	}
+
+	return count;
+}
+
+// decimal, or hexadecimal when prefixed with `0x` or `$` (or always, for .sym addresses)
+
+bool parse_number(std::string_view text, unsigned& result, bool isHex = false) {
+	if (text.starts_with("0x") || text.starts_with("0X")) {
+		text.remove_prefix(2);
+		isHex = true;
+	} else if (text.starts_with("$")) {
+		text.remove_prefix(1);
+		isHex = true;
+	}
+
+	if (text.empty() || text.size() > (isHex ? 8 : 10))
+		return false;
+
+	const unsigned base = isHex ? 16 : 10;
+	std::uint64_t value = 0;
+
+	for (char c : text) {
+		unsigned digit = DIGIT_VALUES[static_cast<unsigned char>(c)];
+
+		if (digit >= base)
+			return false;
+
+		value = value * base + digit;
+	}
+
+	if (value > 0xFFFFFFFF)
+		return false;
+
+	result = value;
+	return true;
+}
+
+bool equals_lower(std::string_view text, std::string_view lower) {
+	return std::equal(text.begin(), text.end(), lower.begin(), lower.end(), [] (char a, char b) {
+		return ((a >= 'A' && a <= 'Z') ? (a - 'A' + 'a') : a) == b;
+	});
+}
+
+// no$gba .sym directives: `.arm` and `.thumb` start code of that mode, `.byt:`, `.wrd:`, `.dbl:` and `.asc:` give a block of data (with its size in hex)
+
+enum class sym_mode : std::uint8_t {
+	None,
+	Arm,
+	Thumb,
+};
+
+struct sym_mode_change {
+	unsigned address;
+	sym_mode mode;
+};
+
+struct sym_data_block {
+	unsigned begin;
+	unsigned end;
+};
+
+void read_sym_directive(std::string_view directive, unsigned address, std::vector<sym_mode_change>& modes, std::vector<sym_data_block>& dataBlocks) {
+	if (equals_lower(directive, ".arm")) {
+		modes.push_back({ address, sym_mode::Arm });
+	} else if (equals_lower(directive, ".thumb")) {
+		modes.push_back({ address, sym_mode::Thumb });
+	} else if (directive.size() > 5 && directive[4] == ':') {
+		auto kind = directive.substr(0, 4);
+		unsigned size = 0;
+
+		if ((equals_lower(kind, ".byt") || equals_lower(kind, ".wrd") || equals_lower(kind, ".dbl") || equals_lower(kind, ".asc"))
+			&& parse_number(directive.substr(5), size, true))
+		{
+			dataBlocks.push_back({ address, address + size });
+		}
+	}
+}
+
+// no$gba never sets the thumb bit, so the type of .sym symbols is told from the directives around them:
+// symbols in data blocks are data, symbols in code are functions of its mode (thumb ones getting the thumb bit)
+
+void apply_sym_directives(std::vector<symbol_list_entry>& entries, std::span<const std::size_t> symEntries,
+	std::vector<sym_mode_change>& modes, std::vector<sym_data_block>& dataBlocks)
+{
+	// (these are by address rather than in the order they are listed, as symbols and directives at the same address may be in either order)
+
+	std::stable_sort(modes.begin(), modes.end(), [] (const sym_mode_change& a, const sym_mode_change& b) {
+		return a.address < b.address;
+	});
+
+	std::sort(dataBlocks.begin(), dataBlocks.end(), [] (const sym_data_block& a, const sym_data_block& b) {
+		return a.begin < b.begin;
+	});
+
+	for (auto index : symEntries) {
+		auto& entry = entries[index];
+
+		auto block = std::upper_bound(dataBlocks.begin(), dataBlocks.end(), entry.address, [] (unsigned address, const sym_data_block& block) {
+			return address < block.begin;
+		});
+
+		if (block != dataBlocks.begin() && entry.address < std::prev(block)->end) {
+			entry.isFunction = false;
+			continue;
+		}
+
+		auto change = std::upper_bound(modes.begin(), modes.end(), entry.address, [] (unsigned address, const sym_mode_change& change) {
+			return address < change.address;
+		});
+
+		sym_mode mode = (change == modes.begin()) ? sym_mode::None : std::prev(change)->mode;
+
+		if (mode == sym_mode::Thumb) {
+			entry.isFunction = true;
+			entry.address |= 1;
+		} else if (mode == sym_mode::Arm) {
+			entry.isFunction = true;
+		}
+	}
+}
+
+bool parse_type(std::string_view text, bool& isFunction) {
+	for (auto keyword : { "func", "function", "code", "thumb", "arm" }) {
+		if (equals_lower(text, keyword)) {
+			isFunction = true;
+			return true;
+		}
+	}
+
+	for (auto keyword : { "data", "object" }) {
+		if (equals_lower(text, keyword)) {
+			isFunction = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+} // namespace
+
+std::vector<symbol_list_entry> parse_symbol_list(std::string_view fileName, std::string_view text) {
+	std::vector<symbol_list_entry> result;
+	result.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+
+	token_array tokens;
+	token_array fields;
+
+	unsigned lineNumber = 0;
+	bool isFirstLine = true;
+
+	// .sym symbols without a type, and the directives that give it
+
+	std::vector<std::size_t> symEntries;
+	std::vector<sym_mode_change> symModes;
+	std::vector<sym_data_block> symDataBlocks;
+
+	for (std::size_t pos = 0; pos < text.size(); ) {
+		std::size_t end = text.find('\n', pos);
+
+		if (end == std::string_view::npos)
+			end = text.size();
+
+		std::string_view line = text.substr(pos, end - pos);
+
+		pos = end + 1;
+		lineNumber++;
+
+		// `#define` would otherwise read as a comment
+
+		bool isDefine = false;
+
+		if (std::size_t first = line.find_first_not_of(" \t"); first != std::string_view::npos && line.substr(first).starts_with("#define")) {
+			line.remove_prefix(first + 7);
+
+			if (line.empty() || class_of(line[0]) != Blank)
+				line = "#"; // not quite a #define, so this is some other directive (which is skipped like a comment)
+			else
+				isDefine = true;
+		}
+
+		unsigned count = tokenize(line, tokens);
+
+		if (count == 0)
+			continue;
+
+		symbol_list_entry entry { {}, 0, 0, false };
+		bool hasType = false;
+
+		// what's after the address: an optional size and an optional type, in any order
+
+		auto readExtras = [&entry, &hasType] (const std::string_view* begin, const std::string_view* end) -> bool {
+			bool hasSize = false;
+
+			for (auto it = begin; it != end; ++it) {
+				if (it->empty())
+					continue;
+
+				if (!hasSize && parse_number(*it, entry.size))
+					hasSize = true;
+				else if (!hasType && parse_type(*it, entry.isFunction))
+					hasType = true;
+				else
+					return false;
+			}
+
+			return true;
+		};
+
+		bool isValid = false;
+		bool isSkipped = false;
+		bool isSym = false;
+
+		const bool isTooLong = count > MAX_TOKENS;
+		const bool hasSeparators = !isTooLong && std::any_of(tokens.begin(), tokens.begin() + count, [] (std::string_view token) {
+			return class_of(token[0]) == Separator;
+		});
+
+		if (isTooLong) {
+			isValid = false;
+		} else if (!isDefine && count >= 3 && is_separator(tokens[1], '=')) {
+			// name = address [size] [type]
+
+			entry.name = tokens[0];
+
+			isValid = class_of(tokens[0][0]) != Separator
+				&& std::none_of(tokens.begin() + 2, tokens.begin() + count, [] (std::string_view token) { return class_of(token[0]) == Separator; })
+				&& parse_number(tokens[2], entry.address)
+				&& readExtras(tokens.data() + 3, tokens.data() + count);
+		} else if (!isDefine && hasSeparators) {
+			// CSV, fields are single words between commas (which may be empty)
+
+			unsigned fieldCount = 0;
+			bool isFieldDone = false;
+
+			fields[0] = {};
+			isValid = true;
+
+			for (unsigned i = 0; i < count && isValid; ++i) {
+				if (is_separator(tokens[i], ',')) {
+					fields[++fieldCount] = {};
+					isFieldDone = false;
+				} else if (is_separator(tokens[i], '=') || isFieldDone) {
+					isValid = false;
+				} else {
+					std::string_view field = tokens[i];
+
+					if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+						field = field.substr(1, field.size() - 2);
+
+					fields[fieldCount] = field;
+					isFieldDone = true;
+				}
+			}
+
+			fieldCount++;
+
+			if (isValid && fieldCount >= 2) {
+				if (parse_number(fields[0], entry.address)) {
+					entry.name = fields[1];
+				} else if (parse_number(fields[1], entry.address)) {
+					entry.name = fields[0];
+				} else {
+					isValid = false;
+					isSkipped = isFirstLine; // header
+				}
+
+				isValid = isValid && !entry.name.empty() && readExtras(fields.data() + 2, fields.data() + fieldCount);
+			} else {
+				isValid = false;
+			}
+		} else if (isDefine) {
+			// #define name address [size] [type]
+
+			entry.name = tokens[0];
+
+			isValid = count >= 2 && !hasSeparators
+				&& parse_number(tokens[1], entry.address)
+				&& readExtras(tokens.data() + 2, tokens.data() + count);
+		} else {
+			// address name (no$gba .sym)
+
+			entry.name = (count >= 2) ? tokens[1] : std::string_view();
+
+			isValid = count >= 2
+				&& parse_number(tokens[0], entry.address, true)
+				&& readExtras(tokens.data() + 2, tokens.data() + count);
+
+			// no$gba directives (.thumb, .arm, .byt:0004, ...)
+
+			isSkipped = isValid && entry.name.starts_with('.');
+			isSym = isValid && !hasType;
+
+			if (isSkipped)
+				read_sym_directive(entry.name, entry.address, symModes, symDataBlocks);
+		}
+
+		isFirstLine = false;
+
+		if (isSkipped)
+			continue;
+
+		if (!isValid)
+			throw std::runtime_error(std::format("{0}:{1}: expected `<name> = <address>`, `#define <name> <address>`, `<address> <name>` or CSV fields",
+				fileName, lineNumber));
+
+		if (!hasType)
+			entry.isFunction = (entry.address & 1) != 0;
+
+		if (isSym)
+			symEntries.push_back(result.size());
+
+		result.push_back(entry);
+	}
+
+	if (!symModes.empty() || !symDataBlocks.empty())
+		apply_sym_directives(result, symEntries, symModes, symDataBlocks);
+
+	return result;
+}
+
+bool is_symbol_list_file(std::string_view fileName) {
+	std::size_t dot = fileName.rfind('.');
+
+	if (dot == std::string_view::npos || fileName.find_first_of("/\\", dot) != std::string_view::npos)
+		return false;
+
+	std::string_view extension = fileName.substr(dot + 1);
+
+	return equals_lower(extension, "sym")
+		|| equals_lower(extension, "csv")
+		|| equals_lower(extension, "txt")
+		|| equals_lower(extension, "event");
+}
+
+} // namespace lyn
@@ -0,0 +1,53 @@
+#ifndef SYMBOL_LIST_H
+#define SYMBOL_LIST_H
+
+#include <string_view>
+#include <vector>
+
+namespace lyn {
+
+/*!
+ * \brief absolute symbols read from a text symbol list
+ *
+ * Each line of a list gives one symbol, in any of these forms:
+ *
+ *   name = 0x08001234 [<size>] [<type>]     (as in linker scripts, a trailing `;` is fine)
+ *   #define name 0x08001234 [<size>] [<type>] (Event Assembler definitions)
+ *   08001234 name                           (no$gba .sym files, the address is always hex)
+ *   name,0x08001234[,<size>][,<type>]       (CSV, address and name can be either way around)
+ *
+ * Type is `func` (or `function`, `code`, `thumb`, `arm`) or `data` (or
+ * `object`). Without one, symbols with the thumb bit set are functions.
+ * Addresses and sizes are decimal unless prefixed with `0x` or `$`.
+ *
+ * no$gba never sets the thumb bit, its directives (names starting with a
+ * dot) say what is where instead: `.arm` and `.thumb` start code of that
+ * mode, and `.byt:`, `.wrd:`, `.dbl:` and `.asc:` give blocks of data. Its
+ * symbols in data blocks are data, and those in code are functions (which
+ * get the thumb bit in thumb code). Symbols before any directive go by the
+ * thumb bit like the others.
+ *
+ * Empty lines, comments (`#`, `;` or `//`) and a CSV header line are
+ * skipped.
+ *
+ */
+struct symbol_list_entry {
+	std::string_view name;
+
+	unsigned address;
+	unsigned size;
+	bool isFunction;
+};
+
+/* names are views into the text, as they are in the list (dots aren't replaced)
+ * throws on the first line that can't be read, with fileName and the line number in the message */
+
+std::vector<symbol_list_entry> parse_symbol_list(std::string_view fileName, std::string_view text);
+
+/* whether a file is to be read as a symbol list, which is told from its extension (.sym, .csv, .txt or .event) */
+
+bool is_symbol_list_file(std::string_view fileName);
+
+} // namespace lyn
+
+#endif // SYMBOL_LIST_H
@@ -0,0 +1,39 @@
+#include "symbol_ref.h"
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+
+namespace lyn {
+
+template<typename OutputIt>
+static OutputIt format_symbol_ref(OutputIt out, const symbol_ref& ref) {
+	if (!ref.is_local_key())
+		return std::copy(ref.text().begin(), ref.text().end(), out);
+
+	unsigned table = (ref.local_key() >> 32) - 1;
+	unsigned index = ref.local_key() & 0xFFFFFFFF;
+
+	return std::format_to(out, "_L{0:X}_{1:X}", table, index);
+}
+
+std::string symbol_ref::str() const {
+	std::string result;
+	format_symbol_ref(std::back_inserter(result), *this);
+
+	return result;
+}
+
+void symbol_ref::append_to(std::pmr::string& output) const {
+	format_symbol_ref(std::back_inserter(output), *this);
+}
+
+std::ostream& operator << (std::ostream& output, const symbol_ref& ref) {
+	if (!ref.is_local_key())
+		return output << ref.text();
+
+	format_symbol_ref(std::ostream_iterator<char>(output), ref);
+	return output;
+}
+
+} // namespace lyn
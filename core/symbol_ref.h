@@ -0,0 +1,70 @@
+#ifndef SYMBOL_REF_H
+#define SYMBOL_REF_H
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace lyn {
+
+/*!
+ * \brief name of a symbol, as used to match symbols with relocations
+ *
+ * Locals are referred to by key (the symbol table they come from and their
+ * index in it) rather than by text. They are only given a textual name
+ * (_L<table>_<index>) when they are written out, which most never are.
+ *
+ */
+struct symbol_ref {
+	symbol_ref() = default;
+
+	symbol_ref(std::string_view text) : mText(text) {}
+	symbol_ref(const char* text) : mText(text) {}
+
+	template<typename Allocator>
+	symbol_ref(const std::basic_string<char, std::char_traits<char>, Allocator>& text) : mText(text) {}
+
+	static symbol_ref local(unsigned table, unsigned index) {
+		symbol_ref result;
+		result.mLocalKey = make_local_key(table, index);
+
+		return result;
+	}
+
+	/* keys are never 0, so that 0 can mean "not a local key" */
+	static std::uint64_t make_local_key(unsigned table, unsigned index) {
+		return (static_cast<std::uint64_t>(table + 1) << 32) | index;
+	}
+
+	bool is_local_key() const { return mLocalKey != 0; }
+	std::uint64_t local_key() const { return mLocalKey; }
+
+	/* empty for locals */
+	std::string_view text() const { return mText; }
+
+	std::string str() const;
+	void append_to(std::pmr::string& output) const;
+
+	bool operator == (const symbol_ref& other) const = default;
+
+	struct hash {
+		std::size_t operator () (const symbol_ref& ref) const {
+			return ref.is_local_key()
+				? std::hash<std::uint64_t>()(ref.mLocalKey)
+				: std::hash<std::string_view>()(ref.mText);
+		}
+	};
+
+private:
+	std::string_view mText;
+	std::uint64_t mLocalKey = 0;
+};
+
+std::ostream& operator << (std::ostream& output, const symbol_ref& ref);
+
+} // namespace lyn
+
+#endif // SYMBOL_REF_H
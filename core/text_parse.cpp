@@ -0,0 +1,57 @@
+#include "text_parse.h"
+
+#include <exception>
+
+namespace lyn {
+
+std::vector<std::string> split_config_line(const std::string& line) {
+	std::vector<std::string> result;
+	std::string field;
+
+	for (char c : line) {
+		if (c == ' ' || c == '\t' || c == ',' || c == '\r') {
+			if (!field.empty())
+				result.push_back(std::move(field));
+
+			field.clear();
+			continue;
+		}
+
+		if (field.empty() && (c == '#' || c == ';'))
+			break;
+
+		field.push_back(c);
+	}
+
+	if (!field.empty())
+		result.push_back(std::move(field));
+
+	return result;
+}
+
+bool parse_config_number(const std::string& text, unsigned long long& result) {
+	std::size_t begin = 0;
+	int base = 10;
+
+	if (text.starts_with("0x") || text.starts_with("0X")) {
+		begin = 2;
+		base = 16;
+	} else if (text.starts_with("$")) {
+		begin = 1;
+		base = 16;
+	}
+
+	if (begin == text.size())
+		return false;
+
+	try {
+		std::size_t end = 0;
+		result = std::stoull(text.substr(begin), &end, base);
+
+		return (begin + end) == text.size();
+	} catch (const std::exception&) {
+		return false;
+	}
+}
+
+} // namespace lyn
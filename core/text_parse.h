@@ -0,0 +1,20 @@
+#ifndef TEXT_PARSE_H
+#define TEXT_PARSE_H
+
+#include <string>
+#include <vector>
+
+namespace lyn {
+
+/* splits a line of a lyn configuration file into fields
+ * fields are separated by whitespace or commas, and a field starting with `#` or `;` ends the line */
+
+std::vector<std::string> split_config_line(const std::string& line);
+
+/* parses a decimal or hexadecimal (`0x` or `$` prefixed) number, returns false if the text isn't one */
+
+bool parse_config_number(const std::string& text, unsigned long long& result);
+
+} // namespace lyn
+
+#endif // TEXT_PARSE_H
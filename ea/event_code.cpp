@@ -11,10 +11,16 @@ std::vector<event_code::event_code_type> event_code::msCodeTypeLibrary = {
 };
 
 event_code::event_code(code_type_enum type, const std::string& argument)
-	: mCodeType(type), mArguments({ argument }) {}
+	: mCodeType(type) { mArguments.emplace_back(argument); }
 
 event_code::event_code(code_type_enum type, const std::initializer_list<std::string>& arguments)
-	: mCodeType(type), mArguments(arguments) {}
+	: mCodeType(type), mArguments(arguments.begin(), arguments.end()) {}
+
+event_code::event_code(code_type_enum type, std::vector<std::string>&& arguments)
+	: mCodeType(type), mArguments(arguments.begin(), arguments.end()) {}
+
+event_code::event_code(code_type_enum type, std::pmr::vector<std::pmr::string>&& arguments)
+	: mCodeType(type), mArguments(std::move(arguments)) {}
 
 void event_code::write_to_stream(std::ostream& output) const {
 	auto& codeType = msCodeTypeLibrary[mCodeType];
@@ -1,6 +1,7 @@
 #ifndef EVENT_CODE_H
 #define EVENT_CODE_H
 
+#include <memory_resource>
 #include <vector>
 #include <string>
 #include <ostream>
@@ -18,6 +19,10 @@ struct event_code {
 public:
 	event_code(code_type_enum type, const std::string& argument);
 	event_code(code_type_enum type, const std::initializer_list<std::string>& arguments);
+	event_code(code_type_enum type, std::vector<std::string>&& arguments);
+
+	// arguments keep their memory resource, which has to outlive the code
+	event_code(code_type_enum type, std::pmr::vector<std::pmr::string>&& arguments);
 
 	void write_to_stream_misaligned(std::ostream& output) const;
 	void write_to_stream(std::ostream& output) const;
@@ -27,7 +32,7 @@ public:
 
 private:
 	code_type_enum mCodeType;
-	std::vector<std::string> mArguments;
+	std::pmr::vector<std::pmr::string> mArguments;
 
 private:
 	struct event_code_type {
@@ -4,20 +4,9 @@
 #include <format>
 #include <cstdint>
 
-namespace lyn {
-
-template<typename IntType, unsigned int ByteCount = sizeof(IntType)>
-static IntType read_le(std::span<const unsigned char> bytes) {
-	IntType result { 0 };
+#include "core/data_chunk.h"
 
-	assert(bytes.size() >= ByteCount);
-
-	for (unsigned int i = 0; i < ByteCount; ++i) {
-		result |= static_cast<IntType>(bytes[i]) << (i * 8);
-	}
-
-	return result;
-}
+namespace lyn {
 
 void write_event_bytes(std::ostream& output, int alignment, std::span<const unsigned char> bytes) {
 	/* This could probably be made to produce denser results in weird cases
@@ -36,7 +25,7 @@ void write_event_bytes(std::ostream& output, int alignment, std::span<const unsi
 			std::format_to(output_it, "WORD");
 
 			while (length_left >= 4) {
-				uint32_t value { read_le<uint32_t>(bytes.subspan(offset, 4)) };
+				uint32_t value { load_le<uint32_t>(bytes.data() + offset) };
 				std::format_to(output_it, " ${0:X}", value);
 
 				offset += 4;
@@ -45,7 +34,7 @@ void write_event_bytes(std::ostream& output, int alignment, std::span<const unsi
 
 			*output_it++ = '\n';
 		} else if ((length_left >= 2) && ((alignment % 2) == 0)) {
-			uint32_t value { read_le<uint16_t>(bytes.subspan(offset, 2)) };
+			uint32_t value { load_le<uint16_t>(bytes.data() + offset) };
 			std::format_to(output_it, "SHORT ${0:X}\n", value);
 
 			alignment += 2;
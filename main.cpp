@@ -1,16 +1,52 @@
+#include <algorithm>
+#include <chrono>
 #include <format>
+#include <fstream>
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "config.h"
 
+#include "core/ar_archive.h"
+#include "core/branch_index.h"
+#include "core/content_cache.h"
 #include "core/event_object.h"
+#include "core/file_cache.h"
+#include "core/file_watcher.h"
+#include "core/free_space.h"
+#include "core/hash.h"
+#include "core/jobserver.h"
+#include "core/link_server.h"
+#include "core/parallel.h"
+#include "core/mapped_file.h"
+#include "core/prepared_file.h"
+#include "core/symbol_db.h"
+#include "core/symbol_list.h"
+#include "core/text_parse.h"
+
+#include "elfcpp/elfcpp.h"
+#include "elfcpp/arm.h"
 
 void print_usage(std::ostream& out)
 {
 	out << PROJECT_NAME " " PROJECT_VERSION " usage:" << std::endl;
-	out << "  lyn <object>... [-[no]link] [-[no]longcalls] [-[no]temp] [-[no]hook] [-raw]" << std::endl;
+	out << "  lyn <object|archive|symbol list|symbol database>... [-[no]link] [-[no]longcalls] [-[no]temp] [-[no]hook] [-[no]inplace] [-raw]" << std::endl;
+	out << "      [-profile <profile>] [-regions <regions>] [-report <file>] [-o <file>] [-MD] [-MF <file>]" << std::endl;
+	out << "      [-[no]cache] [-cachestats] [-watch] [-j <threads>]" << std::endl;
+	out << "      [-rom <base rom>] [-[no]retarget] [-[no]freespace] [-freemin <size>] [-freealign <alignment>]" << std::endl;
 	out << "  lyn diff <old object> <new object>" << std::endl;
+	out << "  lyn symdb build <symbol database> <object|symbol list>..." << std::endl;
+	out << "  lyn prep <object> -o <prepared object>" << std::endl;
+	out << "  lyn serve [<socket>]" << std::endl;
+	out << "  lyn batch [-j <threads>] <manifest>" << std::endl;
 }
 
 int do_diff(int argc, const char* const* argv)
@@ -38,10 +74,10 @@ int do_diff(int argc, const char* const* argv)
 	   std::map<unsigned, sym_diff_data> symMap;
 
 	   for (auto& sym : baseObject.absolute_symbols())
-		   symMap[sym.offset].baseName = sym.name;
+		   symMap[sym.offset].baseName = sym.name.str();
 
 	   for (auto& sym : otherObject.absolute_symbols())
-		   symMap[sym.offset].otherName = sym.name;
+		   symMap[sym.offset].otherName = sym.name.str();
 
 	   for (auto& pair : symMap)
 	   {
@@ -70,28 +106,274 @@ int do_diff(int argc, const char* const* argv)
    return 0;
 }
 
-int main(int argc, char** argv)
+// objects are either ELF objects or prepared objects (from lyn prep), which are told apart by their contents
+
+void append_object(lyn::event_object& object, const std::string& fileName)
 {
-	if (argc < 2)
+	if (lyn::prepared_reader::is_prepared_file(fileName))
+		object.append_from_prepared(fileName.c_str());
+	else
+		object.append_from_elf(fileName.c_str());
+}
+
+int do_symdb(int argc, const char* const* argv)
+{
+	if (argc < 3 || std::strcmp(argv[0], "build"))
 	{
 		print_usage(std::cerr);
 		return 1;
 	}
 
-	if (!std::strcmp(argv[1], "diff"))
-		return do_diff(argc - 2, argv + 2);
+	try
+	{
+		lyn::event_object object;
+
+		for (int i = 2; i < argc; ++i)
+		{
+			if (lyn::is_symbol_list_file(argv[i]))
+				object.append_from_symbol_list(argv[i]);
+			else
+				append_object(object, argv[i]);
+		}
+
+		std::vector<lyn::symbol_db::entry> entries;
+
+		for (auto& sym : object.absolute_symbols())
+		{
+			if (!sym.name.is_local_key())
+				entries.push_back({ sym.name.text(), sym.offset, sym.size, sym.is_function });
+		}
+
+		lyn::symbol_db::write(argv[1], entries);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "[lyn symdb] ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int do_prep(int argc, const char* const* argv)
+{
+	if (argc != 3 || std::strcmp(argv[1], "-o"))
+	{
+		print_usage(std::cerr);
+		return 1;
+	}
+
+	try
+	{
+		lyn::event_object object;
+
+		object.append_from_elf(argv[0]);
+		object.write_prepared(argv[2]);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "[lyn prep] ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+// writes a dependency file (as understood by make and ninja) making target depend on every input
+
+void write_dep_file(const std::string& fileName, const std::string& target, const std::vector<std::string>& inputs)
+{
+	// as gcc does it: spaces and # are escaped with a backslash, $ is doubled (backslashes are left alone, for windows paths)
+
+	auto escape = [] (std::string_view path)
+	{
+		std::string result;
+
+		for (char c : path)
+		{
+			if (c == ' ' || c == '#')
+				result += '\\';
+			else if (c == '$')
+				result += '$';
+
+			result += c;
+		}
+
+		return result;
+	};
+
+	std::string text = escape(target) + ":";
+	std::unordered_set<std::string_view> listed;
+
+	for (auto& input : inputs)
+	{
+		if (listed.insert(input).second)
+			text += " \\\n  " + escape(input);
+	}
+
+	text += "\n";
 
+	lyn::update_file(fileName, std::span(reinterpret_cast<const std::uint8_t*>(text.data()), text.size()));
+}
+
+// rewrites direct calls to a replaced function so that they go straight to the replacement
+// returns the number of call sites that were rewritten
+
+unsigned write_retargeted_calls(
+	std::ostream& out,
+	const lyn::branch_index& index,
+	const lyn::mapped_file& rom,
+	const lyn::event_object::hook& hook)
+{
+	// we need to know where the replacement is to know whether it can be reached
+
+	if (!hook.replacementOffset)
+		return 0;
+
+	unsigned target = *hook.replacementOffset;
+	bool isThumb = (target & 1) != 0;
+
+	unsigned count = 0;
+
+	for (auto& branch : index.branches_to(hook.originalOffset & ~1))
+	{
+		// BL doesn't switch between ARM and thumb, and the reach of branches is limited
+
+		if ((branch.kind == lyn::branch_index::ThumbBL) != isThumb)
+			continue;
+
+		if (!lyn::branch_index::can_reach(branch.kind, branch.offset, target & ~1))
+			continue;
+
+		unsigned relocationType = elfcpp::R_ARM_THM_CALL;
+
+		if (branch.kind == lyn::branch_index::ArmBL)
+			relocationType = elfcpp::R_ARM_CALL;
+		else if (branch.kind == lyn::branch_index::ArmB)
+			relocationType = elfcpp::R_ARM_JUMP24;
+
+		lyn::section_data patch;
+		patch.assign(rom.data() + branch.offset, rom.data() + branch.offset + 4);
+
+		lyn::arm_relocator::get_descriptor(relocationType)->apply_relocation(patch, 0, (target & ~1) - branch.offset, 0);
+		patch.set_address(branch.offset);
+
+		lyn::event_object temp;
+
+		temp.add_section(std::move(patch));
+		temp.write_events(out);
+
+		count++;
+	}
+
+	return count;
+}
+
+// for -j
+
+bool parse_thread_limit(const char* text, unsigned& result)
+{
+	unsigned long long value = 0;
+
+	if (!lyn::parse_config_number(text, value) || value == 0 || value > 0x400)
+		return false;
+
+	result = value;
+	return true;
+}
+
+// caches kept from one link to the next by lyn serve and -watch (links on their own make their own)
+
+// (an empty cache directory keeps them in memory only)
+
+struct link_caches
+{
+	link_caches(const std::filesystem::path& cacheDirectory, std::uintmax_t maxSize)
+		: objects(cacheDirectory.empty() ? cacheDirectory : cacheDirectory / "objects", ".lyo", maxSize)
+		, links(cacheDirectory.empty() ? cacheDirectory : cacheDirectory / "links", ".event", maxSize)
+	{
+	}
+
+	void keep_in_memory(std::uintmax_t maxSize)
+	{
+		objects.set_memory_limit(maxSize);
+		links.set_memory_limit(maxSize);
+	}
+
+	lyn::content_cache objects;
+	lyn::content_cache links;
+};
+
+// what a link goes by besides its arguments: the environment of this process, or the one lyn serve was given by a client
+// (lyn serve runs links for several clients at once, so it can't change its own working directory or environment for them)
+
+struct link_environment
+{
+	std::filesystem::path workingDirectory; // relative file names are resolved against this (empty for the current directory)
+
+	std::filesystem::path cacheDirectory; // (empty to not cache anything)
+	std::uintmax_t cacheSize = 0;
+
+	lyn::jobserver* jobserver = nullptr;
+
+	static link_environment of_process()
+	{
+		return { {}, lyn::cache_directory(), lyn::content_cache::default_max_size(), lyn::jobserver::from_environment() };
+	}
+};
+
+// inputFiles (if given) gets the files given to the link, even if it fails
+
+int do_link(int argc, const char* const* argv, std::ostream& output, std::ostream& errors, const link_environment& environment, link_caches* caches, std::vector<std::string>* inputFiles = nullptr)
+{
 	struct
 	{
 		bool doLink          = true;
 		bool longCall        = false;
 		bool applyHooks      = true;
+		bool inPlaceHooks    = true;
+		bool retargetCalls   = false;
 		bool printTemporary  = false;
+		bool findFreeSpace   = false;
+		bool useCache        = true;
+		bool printCacheStats = false;
+
+		unsigned freeSpaceMinSize = 0x100;
+		unsigned freeSpaceAlign   = 4;
+
+		unsigned threadLimit = 0; // 0 to go by the jobserver or the hardware
+
+		std::string profileFile;
+		std::string regionFile;
+		std::string reportFile;
+		std::string romFile;
+		std::string outputFile;
+		std::string depFile;
+
+		bool writeDepFile = false;
 	} options;
 
 	std::vector<std::string> elves;
+	std::vector<std::string> archives;
+	std::vector<std::string> symbolDbs;
+	std::vector<std::string> symbolLists;
 
-	for (int i = 1; i < argc; ++i)
+	// the dependency file lists files by the names they were given
+
+	std::unordered_map<std::string, std::string> givenNames;
+
+	auto resolve = [&environment, &givenNames] (std::string fileName)
+	{
+		if (environment.workingDirectory.empty() || std::filesystem::path(fileName).is_absolute())
+			return fileName;
+
+		std::string resolved = (environment.workingDirectory / fileName).string();
+		givenNames.emplace(resolved, std::move(fileName));
+
+		return resolved;
+	};
+
+	for (int i = 0; i < argc; ++i)
 	{
 		std::string argument(argv[i]);
 
@@ -155,17 +437,370 @@ int main(int argc, char** argv)
 				options.applyHooks = false;
 				continue;
 			}
+
+			if (argument == "-inplace")
+			{
+				options.inPlaceHooks = true;
+				continue;
+			}
+
+			if (argument == "-noinplace")
+			{
+				options.inPlaceHooks = false;
+				continue;
+			}
+
+			if (argument == "-retarget")
+			{
+				options.retargetCalls = true;
+				continue;
+			}
+
+			if (argument == "-noretarget")
+			{
+				options.retargetCalls = false;
+				continue;
+			}
+
+			if (argument == "-freespace")
+			{
+				options.findFreeSpace = true;
+				continue;
+			}
+
+			if (argument == "-nofreespace")
+			{
+				options.findFreeSpace = false;
+				continue;
+			}
+
+			if (argument == "-cache")
+			{
+				options.useCache = true;
+				continue;
+			}
+
+			if (argument == "-nocache")
+			{
+				options.useCache = false;
+				continue;
+			}
+
+			if (argument == "-MD")
+			{
+				options.writeDepFile = true;
+				continue;
+			}
+
+			if (argument == "-cachestats")
+			{
+				options.printCacheStats = true;
+				continue;
+			}
+
+			if (argument == "-j")
+			{
+				if (i + 1 >= argc || !parse_thread_limit(argv[i + 1], options.threadLimit))
+				{
+					errors << "[lyn] ERROR: expected a number of threads after -j" << std::endl;
+					return 1;
+				}
+
+				++i;
+				continue;
+			}
+
+			if (argument == "-freemin" || argument == "-freealign")
+			{
+				unsigned long long value = 0;
+
+				if (i + 1 >= argc || !lyn::parse_config_number(argv[i + 1], value) || value == 0 || value > 0x02000000)
+				{
+					errors << "[lyn] ERROR: expected a size after " << argument << std::endl;
+					return 1;
+				}
+
+				if (argument == "-freealign" && (value & (value - 1)) != 0)
+				{
+					errors << "[lyn] ERROR: " << argument << " must be a power of two" << std::endl;
+					return 1;
+				}
+
+				(argument == "-freemin" ? options.freeSpaceMinSize : options.freeSpaceAlign) = value;
+
+				++i;
+				continue;
+			}
+
+			if (argument == "-profile" || argument == "-regions" || argument == "-report" || argument == "-rom" || argument == "-o" || argument == "-MF")
+			{
+				if (i + 1 >= argc)
+				{
+					errors << "[lyn] ERROR: missing file name after " << argument << std::endl;
+					return 1;
+				}
+
+				if (argument == "-profile")
+					options.profileFile = resolve(argv[++i]);
+				else if (argument == "-regions")
+					options.regionFile = resolve(argv[++i]);
+				else if (argument == "-rom")
+					options.romFile = resolve(argv[++i]);
+				else if (argument == "-o")
+					options.outputFile = resolve(argv[++i]);
+				else if (argument == "-MF")
+					options.depFile = resolve(argv[++i]);
+				else
+					options.reportFile = resolve(argv[++i]);
+
+				continue;
+			}
+
+			continue; // (unknown options are ignored)
+		}
+
+		argument = resolve(std::move(argument));
+
+		if (lyn::ar_archive::is_archive_file(argument)) { // archive
+			archives.push_back(std::move(argument));
+		} else if (lyn::symbol_db::is_symbol_db_file(argument)) { // symbol database
+			symbolDbs.push_back(std::move(argument));
+		} else if (lyn::is_symbol_list_file(argument)) { // symbol list
+			symbolLists.push_back(std::move(argument));
 		} else { // elf
 			elves.push_back(std::move(argument));
 		}
 	}
 
+	if (!options.depFile.empty())
+		options.writeDepFile = true;
+
+	// (-j only goes for this link, not for the others lyn serve or lyn batch run)
+
+	const lyn::scoped_thread_limit threadLimit(options.threadLimit);
+	const lyn::scoped_jobserver jobserver(environment.jobserver);
+
+	if (options.writeDepFile && options.outputFile.empty())
+	{
+		errors << "[lyn] ERROR: -MD and -MF need an output file (-o <file>)" << std::endl;
+		return 1;
+	}
+
+	// (the report is only written by laying out, without any it would be left empty)
+
+	if (!options.reportFile.empty() && options.profileFile.empty() && options.regionFile.empty() && !options.findFreeSpace && !options.retargetCalls)
+	{
+		errors << "[lyn] ERROR: -report needs a layout to report on (-profile, -regions, -freespace or -retarget)" << std::endl;
+		return 1;
+	}
+
+	if (options.writeDepFile && options.depFile.empty())
+		options.depFile = std::filesystem::path(options.outputFile).replace_extension(".d").string();
+
+	// files other than objects that the output depends on
+
+	std::vector<std::string> sideFiles;
+
+	for (auto* fileName : { &options.profileFile, &options.regionFile, &options.romFile })
+	{
+		if (!fileName->empty())
+			sideFiles.push_back(*fileName);
+	}
+
+	// (in the order they are loaded)
+
+	std::vector<std::string> givenFiles;
+
+	for (auto* fileNames : { &symbolDbs, &elves, &symbolLists, &archives, &sideFiles })
+		givenFiles.insert(givenFiles.end(), fileNames->begin(), fileNames->end());
+
+	if (inputFiles)
+		*inputFiles = givenFiles;
+
+	auto writeDepFile = [&options, &givenNames] (const std::vector<std::string>& inputs)
+	{
+		auto asGiven = [&givenNames] (const std::string& fileName)
+		{
+			auto it = givenNames.find(fileName);
+			return it == givenNames.end() ? fileName : it->second;
+		};
+
+		std::vector<std::string> names;
+
+		for (auto& input : inputs)
+			names.push_back(asGiven(input));
+
+		write_dep_file(options.depFile, asGiven(options.outputFile), names);
+	};
+
 	try
 	{
+		const auto cacheDirectory = options.useCache ? environment.cacheDirectory : std::filesystem::path();
+
+		// lyn serve gives its own caches, which are kept from one link to the next
+
+		std::unique_ptr<link_caches> ownCaches;
+
+		lyn::content_cache* objectCache = nullptr;
+		lyn::content_cache* linkCache = nullptr;
+
+		if (options.useCache && caches)
+		{
+			objectCache = &caches->objects;
+			linkCache = &caches->links;
+		}
+		else if (!cacheDirectory.empty())
+		{
+			ownCaches = std::make_unique<link_caches>(cacheDirectory, environment.cacheSize);
+
+			objectCache = &ownCaches->objects;
+			linkCache = &ownCaches->links;
+		}
+
+		// (counted for this link alone, as the caches may be shared with others running at the same time)
+
+		lyn::content_cache::statistics objectStats, linkStats;
+
+		// the output of a link only depends on its inputs (in order) and options, so whole links written to a file are cached on those
+		// (but not with -report, which is only written by actually linking)
+
+		std::uint64_t linkKey = lyn::content_cache::key_seed();
+
+		if (linkCache && (options.outputFile.empty() || !options.reportFile.empty()))
+			linkCache = nullptr;
+
+		if (linkCache)
+		{
+			auto hashText = [&linkKey] (std::string_view text)
+			{
+				linkKey = lyn::hash_string(text, linkKey);
+			};
+
+			auto hashFiles = [objectCache, &hashText] (std::string_view kind, const std::vector<std::string>& fileNames)
+			{
+				for (auto& fileName : fileNames)
+					hashText(std::format("{0}:{1:016X}", kind, objectCache->file_key(fileName)));
+			};
+
+			hashText(std::format("link={0} longcalls={1} hook={2} inplace={3} retarget={4} temp={5} freespace={6} freemin={7} freealign={8}",
+				options.doLink, options.longCall, options.applyHooks, options.inPlaceHooks, options.retargetCalls,
+				options.printTemporary, options.findFreeSpace, options.freeSpaceMinSize, options.freeSpaceAlign));
+
+			// (in the order they are loaded, so that the inputs listed in the dependency file are the same either way)
+
+			hashFiles("symdb", symbolDbs);
+			hashFiles("elf", elves);
+			hashFiles("symlist", symbolLists);
+			hashFiles("archive", archives);
+
+			hashText(std::format("profile={0} regions={1} rom={2}", !options.profileFile.empty(), !options.regionFile.empty(), !options.romFile.empty()));
+			hashFiles("side", sideFiles);
+
+			if (auto entry = linkCache->find(linkKey))
+			{
+				bool isWritten = lyn::update_file(options.outputFile, entry->bytes);
+				linkCache->record_hit(linkKey, linkStats);
+
+				if (options.printCacheStats)
+					errors << "[lyn] link cache: hit" << (isWritten ? "" : " (output unchanged)") << std::endl;
+
+				if (options.writeDepFile)
+					writeDepFile(givenFiles);
+
+				return 0;
+			}
+		}
+
 		lyn::event_object object;
 
-		for (auto& elf : elves)
-			object.append_from_elf(elf.c_str());
+		if (objectCache)
+			object.set_object_cache(objectCache, &objectStats);
+
+		for (auto& symbolDb : symbolDbs)
+			object.add_symbol_db(symbolDb);
+
+		object.append_from_objects(elves);
+
+		for (auto& symbolList : symbolLists)
+			object.append_from_symbol_list(symbolList.c_str());
+
+		// archive members are only pulled in for what the objects need, wherever the archives are given
+
+		if (!archives.empty())
+			object.append_from_archives(archives);
+
+		if (objectCache)
+		{
+			objectCache->trim(objectStats);
+
+			if (options.printCacheStats)
+			{
+				errors << std::format("[lyn] object cache: {0} hits, {1} misses, {2} evicted",
+					objectStats.hits.load(), objectStats.misses.load(), objectStats.evictions.load()) << std::endl;
+			}
+		}
+
+		std::unique_ptr<lyn::mapped_file> rom;
+
+		if (!options.romFile.empty())
+			rom = std::make_unique<lyn::mapped_file>(options.romFile);
+
+		if ((options.retargetCalls || options.findFreeSpace) && !rom)
+			throw std::runtime_error("-retarget and -freespace need a base ROM (-rom <file>)");
+
+		std::ofstream report;
+
+		if (!options.reportFile.empty())
+		{
+			report.open(options.reportFile);
+
+			if (!report.is_open())
+				throw std::runtime_error(std::format("Couldn't open file for write: {0}", options.reportFile));
+		}
+
+		if (!options.profileFile.empty())
+		{
+			lyn::layout_profile profile;
+			profile.load_from_file(options.profileFile.c_str());
+
+			object.apply_layout(profile, report.is_open() ? &report : nullptr);
+		}
+
+		if (options.applyHooks && options.inPlaceHooks)
+			object.place_replacements();
+
+		// with -o, the output is only written once complete (and only if it changed)
+
+		std::ostringstream outputBuffer;
+		std::ostream& out = options.outputFile.empty() ? output : outputBuffer;
+
+		// ROM bytes lyn writes over or was told are free, where calls aren't retargeted
+		// (whatever looks like a call there isn't one anymore, or is about to be overwritten)
+
+		std::vector<lyn::branch_index::rom_range> rewrittenRanges;
+
+		if (!options.regionFile.empty() || options.findFreeSpace)
+		{
+			lyn::region_allocator allocator;
+
+			if (!options.regionFile.empty())
+				allocator.load_from_file(options.regionFile.c_str());
+
+			if (options.findFreeSpace)
+			{
+				auto runs = lyn::find_free_space_cached(*rom, options.freeSpaceMinSize, options.freeSpaceAlign, cacheDirectory, environment.cacheSize);
+
+				// (bytes of the given regions are left out, so that they aren't allocated twice)
+
+				for (auto& run : runs)
+					allocator.add_free_space(run.offset, run.size, options.freeSpaceAlign, options.freeSpaceMinSize);
+			}
+
+			object.allocate_regions(allocator, report.is_open() ? &report : nullptr);
+
+			for (auto& region : allocator.regions())
+				rewrittenRanges.emplace_back(region.start, region.start + region.size);
+		}
 
 		if (options.doLink)
 			object.try_relocate_relatives();
@@ -183,27 +818,442 @@ int main(int argc, char** argv)
 
 		if (options.applyHooks)
 		{
-			for (auto& hook : object.get_hooks())
+			const auto hooks = object.get_hooks();
+
+			lyn::branch_index branches;
+
+			if (options.retargetCalls)
+			{
+				// (calls are only looked for in the functions of the reference symbols, see lyn::branch_index)
+
+				auto placedRanges = object.placed_ranges();
+				rewrittenRanges.insert(rewrittenRanges.end(), placedRanges.begin(), placedRanges.end());
+
+				for (auto& hook : hooks)
+				{
+					const unsigned veneerOffset = hook.originalOffset & ~1;
+					rewrittenRanges.emplace_back(veneerOffset, veneerOffset + lyn::arm_relocator::make_thumb_veneer(hook.name, 0).size());
+				}
+
+				branches.build(rom->bytes(), object.rom_functions(), std::move(rewrittenRanges));
+			}
+
+			for (auto& hook : hooks)
 			{
 				lyn::event_object temp;
 
-				std::cout << "PUSH" << std::endl;
-				std::cout << "ORG $" << std::hex << (hook.originalOffset & (~1)) << std::endl;
+				// the veneer is kept even when calls are retargeted, for indirect calls through pointers
+
+				out << "PUSH" << std::endl;
+				out << "ORG $" << std::hex << (hook.originalOffset & (~1)) << std::endl;
 
 				temp.add_section(lyn::arm_relocator::make_thumb_veneer(hook.name, 0));
-				temp.write_events(std::cout);
+				temp.write_events(out);
+
+				out << "POP" << std::endl;
+
+				if (options.retargetCalls)
+				{
+					unsigned count = write_retargeted_calls(out, branches, *rom, hook);
+
+					if (report.is_open())
+						report << std::format("# retargeted {0} call(s) to {1} (${2:X})", count, hook.name, hook.originalOffset & ~1) << std::endl;
+				}
+			}
+		}
+
+		object.write_events(out);
+
+		if (!options.outputFile.empty())
+		{
+			const std::string text = std::move(outputBuffer).str();
+			const std::span<const std::uint8_t> bytes(reinterpret_cast<const std::uint8_t*>(text.data()), text.size());
+
+			bool isWritten = lyn::update_file(options.outputFile, bytes);
+
+			if (linkCache)
+			{
+				linkCache->store(linkKey, bytes, linkStats);
+				linkCache->trim(linkStats);
+
+				if (options.printCacheStats)
+					errors << "[lyn] link cache: miss" << (isWritten ? "" : " (output unchanged)") << std::endl;
+			}
+		}
+
+		if (options.writeDepFile)
+		{
+			std::vector<std::string> inputs = object.input_files();
+			inputs.insert(inputs.end(), sideFiles.begin(), sideFiles.end());
+
+			writeDepFile(inputs);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		errors << "[lyn] ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+// keeps loaded objects (and their keys) in memory, and runs the links that clients give it with them
+
+int do_serve(int argc, const char* const* argv)
+{
+	if (argc > 1)
+	{
+		print_usage(std::cerr);
+		return 1;
+	}
+
+	try
+	{
+		const std::string socketPath = argc == 1 ? argv[0] : lyn::default_server_socket();
+
+		if (socketPath.empty())
+			throw std::runtime_error("no socket given, and no cache directory to put one in");
+
+		// caches are kept for each cache directory (and size) clients give, as they would be without a server
+
+		std::mutex cachesMutex;
+		std::map<std::pair<std::string, std::uintmax_t>, std::unique_ptr<link_caches>> cachesByDirectory;
+
+		lyn::serve_links(socketPath, [&cachesMutex, &cachesByDirectory] (const lyn::link_request& request)
+		{
+			lyn::link_response response;
+
+			std::ostringstream output, errors;
+
+			try
+			{
+				link_caches* caches;
+
+				{
+					std::lock_guard lock(cachesMutex);
+
+					auto& entry = cachesByDirectory[{ request.cacheDirectory, request.cacheSize }];
+
+					if (!entry)
+					{
+						entry = std::make_unique<link_caches>(request.cacheDirectory, request.cacheSize);
+						entry->keep_in_memory(request.cacheSize);
+					}
+
+					caches = entry.get();
+				}
 
-				std::cout << "POP" << std::endl;
+				// (the tokens taken for the link are given back as it ends, with the jobserver)
+
+				std::unique_ptr<lyn::jobserver> jobserver;
+
+				if (!request.jobserverFifo.empty())
+					jobserver = lyn::jobserver::from_make_flags(std::format("--jobserver-auth=fifo:{0}", request.jobserverFifo));
+
+				const link_environment environment { request.workingDirectory, request.cacheDirectory, request.cacheSize, jobserver.get() };
+
+				std::vector<const char*> arguments;
+
+				for (auto& argument : request.arguments)
+					arguments.push_back(argument.c_str());
+
+				response.exitCode = do_link(arguments.size(), arguments.data(), output, errors, environment, caches);
+			}
+			catch (const std::exception& e)
+			{
+				errors << "[lyn] ERROR: " << e.what() << std::endl;
+				response.exitCode = 1;
 			}
+
+			response.output = std::move(output).str();
+			response.errors = std::move(errors).str();
+
+			return response;
+		});
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "[lyn serve] ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+// links, then links again whenever an input is written, only loading those that changed again
+
+int do_watch(int argc, const char* const* argv)
+{
+	std::vector<const char*> arguments;
+
+	for (int i = 0; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "-watch"))
+			arguments.push_back(argv[i]);
+	}
+
+	if (std::find_if(arguments.begin(), arguments.end(), [] (const char* argument) { return !std::strcmp(argument, "-o"); }) == arguments.end())
+	{
+		std::cerr << "[lyn] ERROR: -watch needs an output file (-o <file>)" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		const auto environment = link_environment::of_process();
+
+		link_caches caches(environment.cacheDirectory, environment.cacheSize);
+		caches.keep_in_memory(environment.cacheSize);
+		std::vector<std::string> inputs;
+
+		const auto firstLinkTime = std::filesystem::file_time_type::clock::now();
+
+		do_link(arguments.size(), arguments.data(), std::cout, std::cerr, environment, &caches, &inputs);
+
+		if (inputs.empty())
+			throw std::runtime_error("no input files to watch");
+
+		lyn::file_watcher watcher(inputs);
+
+		// what was written during the first link (before the watcher was there) is only seen by looking
+
+		std::vector<std::string> changed;
+
+		for (auto& input : inputs)
+		{
+			std::error_code error;
+
+			if (std::filesystem::last_write_time(input, error) >= firstLinkTime && !error)
+				changed.push_back(input);
 		}
 
-		object.write_events(std::cout);
+		std::cerr << "[lyn] watching " << inputs.size() << " file(s)" << std::endl;
+
+		for (;;)
+		{
+			if (changed.empty())
+				changed = watcher.wait_for_changes();
+
+			const auto start = std::chrono::steady_clock::now();
+
+			int result = do_link(arguments.size(), arguments.data(), std::cout, std::cerr, environment, &caches);
+
+			const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+			std::cerr << std::format("[lyn] {0}{1} changed, {2} in {3}ms",
+				changed.front(), changed.size() > 1 ? std::format(" (and {0} more)", changed.size() - 1) : "",
+				result == 0 ? "linked" : "link failed", elapsed.count()) << std::endl;
+
+			changed.clear();
+		}
 	}
 	catch (const std::exception& e)
 	{
 		std::cerr << "[lyn] ERROR: " << e.what() << std::endl;
 		return 1;
 	}
+}
+
+// runs the links listed in a manifest (one per line, with the arguments they would be given on the command line) in parallel
+
+int do_batch(int argc, const char* const* argv)
+{
+	unsigned threadLimit = 0;
+
+	if (argc == 3 && !std::strcmp(argv[0], "-j"))
+	{
+		if (!parse_thread_limit(argv[1], threadLimit))
+		{
+			std::cerr << "[lyn batch] ERROR: expected a number of threads after -j" << std::endl;
+			return 1;
+		}
+
+		argc -= 2;
+		argv += 2;
+	}
+
+	if (argc != 1)
+	{
+		print_usage(std::cerr);
+		return 1;
+	}
+
+	lyn::set_thread_limit(threadLimit);
+
+	struct batch_job
+	{
+		batch_job(unsigned lineNumber, std::vector<std::string> arguments)
+			: lineNumber(lineNumber), arguments(std::move(arguments))
+		{
+		}
+
+		unsigned lineNumber;
+		std::vector<std::string> arguments;
+
+		int exitCode = 1;
+
+		std::string output;
+		std::string errors;
+	};
+
+	const char* const manifestFile = argv[0];
+
+	try
+	{
+		std::vector<batch_job> jobs;
+
+		{
+			std::ifstream input(manifestFile);
+
+			if (!input.is_open())
+				throw std::runtime_error(std::format("Couldn't open manifest for read: {0}", manifestFile));
+
+			std::string line;
+			unsigned lineNumber = 0;
+
+			while (std::getline(input, line))
+			{
+				lineNumber++;
+
+				auto fields = lyn::split_config_line(line);
+
+				if (!fields.empty())
+					jobs.emplace_back(lineNumber, std::move(fields));
+			}
+		}
+
+		// objects given to several links (such as reference objects) are only loaded once, and copied from memory by the others
+
+		const auto environment = link_environment::of_process();
+
+		link_caches caches(environment.cacheDirectory, environment.cacheSize);
+		caches.keep_in_memory(environment.cacheSize);
+
+		auto runJob = [&environment, &caches] (batch_job& job)
+		{
+			std::ostringstream output, errors;
+
+			try
+			{
+				std::vector<const char*> arguments;
+
+				for (auto& argument : job.arguments)
+					arguments.push_back(argument.c_str());
+
+				job.exitCode = do_link(arguments.size(), arguments.data(), output, errors, environment, &caches);
+			}
+			catch (const std::exception& e)
+			{
+				errors << "[lyn] ERROR: " << e.what() << std::endl;
+				job.exitCode = 1;
+			}
+
+			job.output = std::move(output).str();
+			job.errors = std::move(errors).str();
+		};
+
+		// the first link runs on its own, so that what it shares with the others is there for them
+		// (rather than being loaded by every thread at once)
+
+		if (!jobs.empty())
+			runJob(jobs.front());
+
+		if (jobs.size() > 1)
+		{
+			lyn::parallel_for(jobs.size() - 1, [&jobs, &runJob] (std::size_t i)
+			{
+				runJob(jobs[i + 1]);
+			});
+		}
+
+		unsigned failedCount = 0;
+
+		for (auto& job : jobs)
+		{
+			std::cout << job.output;
+			std::cerr << job.errors;
+
+			if (job.exitCode != 0)
+			{
+				std::cerr << std::format("[lyn batch] ERROR: {0}:{1}: link failed", manifestFile, job.lineNumber) << std::endl;
+				failedCount++;
+			}
+		}
+
+		std::cout.flush();
+
+		if (failedCount != 0)
+		{
+			std::cerr << std::format("[lyn batch] {0} of {1} link(s) failed", failedCount, jobs.size()) << std::endl;
+			return 1;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "[lyn batch] ERROR: " << e.what() << std::endl;
+		return 1;
+	}
 
 	return 0;
 }
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		print_usage(std::cerr);
+		return 1;
+	}
+
+	if (!std::strcmp(argv[1], "diff"))
+		return do_diff(argc - 2, argv + 2);
+
+	if (!std::strcmp(argv[1], "symdb"))
+		return do_symdb(argc - 2, argv + 2);
+
+	if (!std::strcmp(argv[1], "prep"))
+		return do_prep(argc - 2, argv + 2);
+
+	if (!std::strcmp(argv[1], "serve"))
+		return do_serve(argc - 2, argv + 2);
+
+	if (!std::strcmp(argv[1], "batch"))
+		return do_batch(argc - 2, argv + 2);
+
+	// -watch keeps its own state, so it isn't given to a server
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strcmp(argv[i], "-watch"))
+			return do_watch(argc - 1, argv + 1);
+	}
+
+	// with a server, links are run by it (and are linked here if it isn't there)
+
+	if (const char* server = std::getenv("LYN_SERVER"); server && *server)
+	{
+		std::error_code error;
+
+		lyn::link_request request;
+
+		request.workingDirectory = std::filesystem::current_path(error).string();
+		request.arguments.assign(argv + 1, argv + argc);
+
+		request.cacheDirectory = lyn::cache_directory().string();
+		request.cacheSize = lyn::content_cache::default_max_size();
+
+		if (auto* jobserver = lyn::jobserver::from_environment())
+			request.jobserverFifo = jobserver->fifo_path();
+
+		if (auto response = lyn::request_link(server, request))
+		{
+			std::cout << response->output << std::flush;
+			std::cerr << response->errors << std::flush;
+
+			return response->exitCode;
+		}
+	}
+
+	return do_link(argc - 1, argv + 1, std::cout, std::cerr, link_environment::of_process(), nullptr);
+}
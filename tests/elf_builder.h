@@ -0,0 +1,182 @@
+#ifndef LYN_TEST_ELF_BUILDER_H
+#define LYN_TEST_ELF_BUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/data_chunk.h"
+
+/*!
+ * \brief just enough of an ARM relocatable ELF writer for lyn to load its objects
+ *
+ * Tests make the objects they link with this, rather than depending on an ARM
+ * toolchain. Symbol and section indices are as in the file (1 based).
+ *
+ */
+namespace lyn::test {
+
+struct elf_section {
+	std::string name;
+	std::uint32_t type;
+	std::uint32_t flags;
+	std::string data;
+};
+
+struct elf_symbol {
+	std::string name;
+	std::uint32_t value;
+	std::uint32_t size;
+	unsigned bind; // 0 local, 1 global
+	unsigned type; // 0 none, 1 object, 2 function, 3 section
+	std::uint16_t sectionIndex; // 1 based, as in the file (0 undefined, 0xFFF1 absolute)
+};
+
+struct elf_relocation {
+	std::string sectionName;
+	std::uint32_t offset;
+	std::uint32_t symbolIndex; // 1 based, as in the file
+	std::uint32_t type;
+};
+
+constexpr std::uint32_t SHT_PROGBITS = 1, SHT_SYMTAB = 2, SHT_STRTAB = 3, SHT_REL = 9;
+constexpr std::uint32_t SHF_ALLOC = 2, SHF_EXECINSTR = 4;
+
+constexpr std::uint32_t R_ARM_ABS32 = 2, R_ARM_REL32 = 3, R_ARM_ABS16 = 5, R_ARM_ABS8 = 8, R_ARM_THM_CALL = 10;
+constexpr std::uint32_t R_ARM_CALL = 28, R_ARM_JUMP24 = 29, R_ARM_V4BX = 40, R_ARM_THM_JUMP11 = 102, R_ARM_THM_JUMP8 = 103;
+
+inline void put32(std::string& out, std::uint32_t value) {
+	std::uint8_t bytes[4];
+	lyn::store_le<std::uint32_t>(bytes, value);
+	out.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+inline void put16(std::string& out, std::uint16_t value) {
+	out += char(value);
+	out += char(value >> 8);
+}
+
+inline std::uint32_t add_string(std::string& table, const std::string& text) {
+	if (text.empty())
+		return 0;
+
+	std::uint32_t offset = table.size();
+	table += text + '\0';
+
+	return offset;
+}
+
+inline std::vector<std::uint8_t> make_elf(std::vector<elf_section> sections, const std::vector<elf_symbol>& symbols, const std::vector<elf_relocation>& relocations) {
+	struct header {
+		std::string name;
+		std::uint32_t type, flags, link, info, entrySize;
+		std::string data;
+	};
+
+	std::vector<header> headers { {} };
+
+	for (auto& section : sections)
+		headers.push_back({ section.name, section.type, section.flags, 0, 0, 0, section.data });
+
+	const std::uint32_t symtabIndex = headers.size() + sections.size();
+
+	for (std::size_t i = 0; i < sections.size(); ++i) {
+		std::string data;
+
+		for (auto& relocation : relocations) {
+			if (relocation.sectionName == sections[i].name) {
+				put32(data, relocation.offset);
+				put32(data, (relocation.symbolIndex << 8) | relocation.type);
+			}
+		}
+
+		headers.push_back({ ".rel" + sections[i].name, SHT_REL, 0, symtabIndex, std::uint32_t(i + 1), 8, data });
+	}
+
+	std::string strtab(1, '\0');
+	std::string symtab(16, '\0');
+
+	std::uint32_t localCount = 1;
+
+	for (auto& symbol : symbols) {
+		put32(symtab, add_string(strtab, symbol.name));
+		put32(symtab, symbol.value);
+		put32(symtab, symbol.size);
+		symtab += char((symbol.bind << 4) | symbol.type);
+		symtab += '\0';
+		put16(symtab, symbol.sectionIndex);
+
+		if (symbol.bind == 0)
+			localCount++;
+	}
+
+	headers.push_back({ ".symtab", SHT_SYMTAB, 0, symtabIndex + 1, localCount, 16, symtab });
+	headers.push_back({ ".strtab", SHT_STRTAB, 0, 0, 0, 0, strtab });
+	headers.push_back({ ".shstrtab", SHT_STRTAB, 0, 0, 0, 0, {} });
+
+	std::string shstrtab(1, '\0');
+	std::vector<std::uint32_t> nameOffsets;
+
+	for (auto& head : headers)
+		nameOffsets.push_back(add_string(shstrtab, head.name));
+
+	headers.back().data = shstrtab;
+
+	// section contents follow the ELF header, and the section headers come last
+
+	std::string body;
+	std::vector<std::uint32_t> offsets;
+
+	for (auto& head : headers) {
+		body.resize((body.size() + 3) & ~3);
+		offsets.push_back(52 + body.size());
+		body += head.data;
+	}
+
+	body.resize((body.size() + 3) & ~3);
+
+	std::string file = std::string("\x7F" "ELF\x01\x01\x01", 7) + std::string(9, '\0');
+
+	put16(file, 1); // relocatable
+	put16(file, 40); // ARM
+	put32(file, 1);
+	put32(file, 0);
+	put32(file, 0);
+	put32(file, 52 + body.size());
+	put32(file, 0x05000000);
+	put16(file, 52);
+	put16(file, 0);
+	put16(file, 0);
+	put16(file, 40);
+	put16(file, headers.size());
+	put16(file, headers.size() - 1);
+
+	file += body;
+
+	for (std::size_t i = 0; i < headers.size(); ++i) {
+		auto& head = headers[i];
+
+		if (i == 0) {
+			file += std::string(40, '\0');
+			continue;
+		}
+
+		for (std::uint32_t value : { nameOffsets[i], head.type, head.flags, 0u, offsets[i], std::uint32_t(head.data.size()), head.link, head.info, 4u, head.entrySize })
+			put32(file, value);
+	}
+
+	return std::vector<std::uint8_t>(file.begin(), file.end());
+}
+
+inline std::string byte_range(unsigned begin, unsigned end) {
+	std::string result;
+
+	for (unsigned i = begin; i < end; ++i)
+		result += char(i);
+
+	return result;
+}
+
+} // namespace lyn::test
+
+#endif // LYN_TEST_ELF_BUILDER_H
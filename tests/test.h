@@ -0,0 +1,104 @@
+#ifndef LYN_TEST_H
+#define LYN_TEST_H
+
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief just enough of a test framework for lyn's tests
+ *
+ * Each test file is a program of its own (run by ctest), made of test cases
+ * declared with TEST_CASE. A failed check is reported with where it is, and
+ * the test case goes on; a test case throwing is a failure too. The program
+ * fails if any check did.
+ *
+ */
+namespace lyn::test {
+
+struct test_case {
+	const char* name;
+	void (*function)();
+};
+
+inline std::vector<test_case>& test_cases() {
+	static std::vector<test_case> cases;
+	return cases;
+}
+
+inline unsigned& failure_count() {
+	static unsigned count = 0;
+	return count;
+}
+
+struct registration {
+	registration(const char* name, void (*function)()) {
+		test_cases().push_back({ name, function });
+	}
+};
+
+inline void check(bool condition, const char* text, const char* file, int line) {
+	if (condition)
+		return;
+
+	std::cerr << file << ":" << line << ": check failed: " << text << std::endl;
+	failure_count()++;
+}
+
+/* a directory of its own for the files a test writes, removed at the end of the test case */
+class temporary_directory {
+public:
+	temporary_directory() {
+		mPath = std::filesystem::temp_directory_path() / std::format("lyn-test-{0:08X}", std::random_device()());
+		std::filesystem::create_directories(mPath);
+	}
+
+	~temporary_directory() {
+		std::error_code error;
+		std::filesystem::remove_all(mPath, error);
+	}
+
+	std::string file(const std::string& name) const { return (mPath / name).string(); }
+
+private:
+	std::filesystem::path mPath;
+};
+
+inline int run_tests() {
+	for (auto& test : test_cases()) {
+		unsigned failuresBefore = failure_count();
+
+		try {
+			test.function();
+		} catch (const std::exception& e) {
+			std::cerr << test.name << ": threw: " << e.what() << std::endl;
+			failure_count()++;
+		}
+
+		std::cerr << (failure_count() == failuresBefore ? "passed: " : "FAILED: ") << test.name << std::endl;
+	}
+
+	return failure_count() == 0 ? 0 : 1;
+}
+
+} // namespace lyn::test
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static ::lyn::test::registration name##_registration(#name, name); \
+	static void name()
+
+#define CHECK(condition) ::lyn::test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+#define CHECK_THROWS(expression) \
+	do { \
+		bool hasThrown = false; \
+		try { (void) (expression); } catch (const std::exception&) { hasThrown = true; } \
+		::lyn::test::check(hasThrown, #expression " throws", __FILE__, __LINE__); \
+	} while (false)
+
+#endif // LYN_TEST_H
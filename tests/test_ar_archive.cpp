@@ -0,0 +1,235 @@
+#include "tests/test.h"
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "core/ar_archive.h"
+
+using lyn::ar_archive;
+
+namespace {
+
+// archives are made here as GNU ar would make them
+
+struct test_member {
+	std::string name;
+	std::string data;
+	std::vector<std::string> symbols;
+};
+
+std::string ar_header(const std::string& name, std::size_t size) {
+	return std::format("{0:<16}{1:<12}{2:<6}{3:<6}{4:<8}{5:<10}`\n", name, 0, 0, 0, 644, size);
+}
+
+std::string ar_member(const std::string& name, const std::string& data) {
+	return ar_header(name, data.size()) + data + ((data.size() & 1) ? "\n" : "");
+}
+
+std::string be32(std::uint32_t value) {
+	return { char(value >> 24), char(value >> 16), char(value >> 8), char(value) };
+}
+
+std::string make_archive(const std::vector<test_member>& members) {
+	// names that don't fit their header go in the long name table
+
+	std::string longNames;
+	std::vector<std::string> headerNames;
+
+	for (auto& member : members) {
+		if (member.name.size() + 1 > 16) {
+			headerNames.push_back(std::format("/{0}", longNames.size()));
+			longNames += member.name + "/\n";
+		} else {
+			headerNames.push_back(member.name + "/");
+		}
+	}
+
+	std::string symbolNames;
+	unsigned symbolCount = 0;
+
+	for (auto& member : members) {
+		for (auto& symbol : member.symbols) {
+			symbolNames += symbol + '\0';
+			symbolCount++;
+		}
+	}
+
+	// the index holds the offsets of the members, which come after it
+
+	std::size_t indexSize = 4 + symbolCount * 4 + symbolNames.size();
+	std::size_t offset = 8 + ar_member("/", std::string(indexSize, '\0')).size();
+
+	if (!longNames.empty())
+		offset += ar_member("//", longNames).size();
+
+	std::string index = be32(symbolCount);
+	std::string body;
+
+	for (std::size_t i = 0; i < members.size(); ++i) {
+		for (std::size_t s = 0; s < members[i].symbols.size(); ++s)
+			index += be32(offset + body.size());
+
+		body += ar_member(headerNames[i], members[i].data);
+	}
+
+	index += symbolNames;
+
+	return "!<arch>\n" + ar_member("/", index) + (longNames.empty() ? "" : ar_member("//", longNames)) + body;
+}
+
+std::span<const std::uint8_t> bytes_of(const std::string& text) {
+	return { reinterpret_cast<const std::uint8_t*>(text.data()), text.size() };
+}
+
+std::string text_of(std::span<const std::uint8_t> bytes) {
+	return { reinterpret_cast<const char*>(bytes.data()), bytes.size() };
+}
+
+const std::vector<test_member> TEST_MEMBERS {
+	{ "short.o", "odd sized", { "ShortFunc", "ShortData" } },
+	{ "a_rather_long_member_name.o", "even size!", { "LongFunc" } },
+	{ "nosymbols.o", "x", {} },
+	{ "another_long_member_name.o", "", { "Empty" } },
+};
+
+} // namespace
+
+TEST_CASE(index_and_members) {
+	const auto archiveData = make_archive(TEST_MEMBERS);
+	const ar_archive archive("test.a", bytes_of(archiveData));
+
+	auto& symbols = archive.symbols();
+
+	CHECK(symbols.size() == 4);
+
+	if (symbols.size() != 4)
+		return;
+
+	CHECK(symbols[0].name == "ShortFunc");
+	CHECK(symbols[1].name == "ShortData");
+	CHECK(symbols[2].name == "LongFunc");
+	CHECK(symbols[3].name == "Empty");
+
+	CHECK(symbols[0].memberOffset == symbols[1].memberOffset);
+
+	auto first = archive.member_at(symbols[0].memberOffset);
+	CHECK(first.name == "short.o");
+	CHECK(text_of(first.data) == "odd sized");
+
+	auto second = archive.member_at(symbols[2].memberOffset);
+	CHECK(second.name == "a_rather_long_member_name.o");
+	CHECK(text_of(second.data) == "even size!");
+
+	auto last = archive.member_at(symbols[3].memberOffset);
+	CHECK(last.name == "another_long_member_name.o");
+	CHECK(last.data.empty());
+}
+
+TEST_CASE(empty_index) {
+	const auto archiveData = make_archive({ { "nosymbols.o", "x", {} } });
+	const ar_archive archive("test.a", bytes_of(archiveData));
+
+	CHECK(archive.symbols().empty());
+}
+
+TEST_CASE(rejects_other_files) {
+	CHECK_THROWS(ar_archive("test.a", bytes_of("")));
+	CHECK_THROWS(ar_archive("test.a", bytes_of("\x7F" "ELF not an archive")));
+	CHECK_THROWS(ar_archive("test.a", bytes_of("!<thin>\n")));
+
+	// without an index (as made by `ar rcS`)
+
+	CHECK_THROWS(ar_archive("test.a", bytes_of("!<arch>\n" + ar_member("member.o/", "data"))));
+	CHECK_THROWS(ar_archive("test.a", bytes_of("!<arch>\n")));
+}
+
+TEST_CASE(archive_files) {
+	lyn::test::temporary_directory directory;
+
+	std::ofstream(directory.file("lib.a"), std::ios::binary) << make_archive(TEST_MEMBERS);
+	std::ofstream(directory.file("thin.a"), std::ios::binary) << "!<thin>\n";
+	std::ofstream(directory.file("object.o"), std::ios::binary) << "\x7F" "ELF";
+
+	CHECK(ar_archive::is_archive_file(directory.file("lib.a")));
+	CHECK(ar_archive::is_archive_file(directory.file("thin.a")));
+	CHECK(!ar_archive::is_archive_file(directory.file("object.o")));
+	CHECK(!ar_archive::is_archive_file(directory.file("missing.a")));
+}
+
+TEST_CASE(rejects_malformed_indexes) {
+	const std::string magic = "!<arch>\n";
+
+	// more symbols than there is room for, a name without its terminator, too small for the count
+
+	CHECK_THROWS(ar_archive("test.a", bytes_of(magic + ar_member("/", be32(3) + be32(100) + std::string("A\0", 2)))));
+	CHECK_THROWS(ar_archive("test.a", bytes_of(magic + ar_member("/", be32(1) + be32(100) + "A"))));
+	CHECK_THROWS(ar_archive("test.a", bytes_of(magic + ar_member("/", "AB"))));
+
+	// headers that don't end right, sizes that aren't numbers or go past the end
+
+	auto archiveData = make_archive(TEST_MEMBERS);
+
+	auto broken = archiveData;
+	broken[8 + 58] = ' ';
+	CHECK_THROWS(ar_archive("test.a", bytes_of(broken)));
+
+	broken = archiveData;
+	broken[8 + 48] = 'x';
+	CHECK_THROWS(ar_archive("test.a", bytes_of(broken)));
+
+	broken = archiveData;
+	broken.replace(8 + 48, 10, "9999999999");
+	CHECK_THROWS(ar_archive("test.a", bytes_of(broken)));
+}
+
+TEST_CASE(rejects_bad_members) {
+	const auto archiveData = make_archive(TEST_MEMBERS);
+	const ar_archive archive("test.a", bytes_of(archiveData));
+
+	CHECK_THROWS(archive.member_at(archiveData.size()));
+	CHECK_THROWS(archive.member_at(archiveData.size() - 10));
+	CHECK_THROWS(archive.member_at(0xFFFFFFFF));
+	CHECK_THROWS(archive.member_at(1)); // not at a header
+
+	// long names out of the table, or that aren't numbers
+
+	for (auto name : { "/99999", "/1x" }) {
+		auto broken = archiveData;
+		const auto offset = archive.symbols()[2].memberOffset;
+
+		broken.replace(offset, 16, std::format("{0:<16}", name));
+
+		const ar_archive brokenArchive("test.a", bytes_of(broken));
+		CHECK_THROWS(brokenArchive.member_at(offset));
+	}
+}
+
+TEST_CASE(truncated_archives_never_read_out_of_the_file) {
+	const auto archiveData = make_archive(TEST_MEMBERS);
+
+	// (out of bounds reads are for the sanitizers to find)
+
+	for (std::size_t size = 0; size < archiveData.size(); ++size) {
+		const std::string truncated = archiveData.substr(0, size);
+
+		try {
+			const ar_archive archive("test.a", bytes_of(truncated));
+
+			for (auto& symbol : archive.symbols()) {
+				try {
+					auto member = archive.member_at(symbol.memberOffset);
+					CHECK(member.data.data() + member.data.size() <= bytes_of(truncated).data() + truncated.size());
+				} catch (const std::exception&) {
+				}
+			}
+		} catch (const std::exception&) {
+		}
+	}
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
@@ -0,0 +1,96 @@
+#include "tests/test.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "core/branch_index.h"
+#include "core/data_chunk.h"
+
+using lyn::branch_index;
+
+namespace {
+
+void put_thumb_bl(std::vector<std::uint8_t>& rom, unsigned offset, unsigned target) {
+	const unsigned displacement = (target - (offset + 4)) >> 1;
+
+	lyn::store_le<std::uint16_t>(rom.data() + offset, 0xF000 | ((displacement >> 11) & 0x7FF));
+	lyn::store_le<std::uint16_t>(rom.data() + offset + 2, 0xF800 | (displacement & 0x7FF));
+}
+
+void put_arm_branch(std::vector<std::uint8_t>& rom, unsigned offset, unsigned target, bool isLink) {
+	const unsigned displacement = (target - (offset + 8)) >> 2;
+
+	lyn::store_le<std::uint32_t>(rom.data() + offset, (isLink ? 0xEB000000 : 0xEA000000) | (displacement & 0xFFFFFF));
+}
+
+std::vector<unsigned> offsets_of(const branch_index& index, unsigned target) {
+	std::vector<unsigned> result;
+
+	for (auto& branch : index.branches_to(target))
+		result.push_back(branch.offset);
+
+	return result;
+}
+
+} // namespace
+
+TEST_CASE(branches_in_code_are_found) {
+	std::vector<std::uint8_t> rom(0x1000);
+
+	put_thumb_bl(rom, 0x102, 0x800);
+	put_thumb_bl(rom, 0x110, 0x080); // backwards
+	put_arm_branch(rom, 0x200, 0x800, true);
+	put_arm_branch(rom, 0x204, 0x800, false);
+
+	branch_index index;
+	index.build(rom, { { 0x100, 0x120, true }, { 0x200, 0x210, false } }, {});
+
+	CHECK(offsets_of(index, 0x800) == std::vector<unsigned>({ 0x102, 0x200, 0x204 }));
+	CHECK(offsets_of(index, 0x080) == std::vector<unsigned>({ 0x110 }));
+
+	auto branches = index.branches_to(0x800);
+
+	CHECK(branches.size() == 3 && branches[0].kind == branch_index::ThumbBL && branches[1].kind == branch_index::ArmBL && branches[2].kind == branch_index::ArmB);
+}
+
+TEST_CASE(branches_outside_known_code_are_left_out) {
+	std::vector<std::uint8_t> rom(0x1000);
+
+	put_thumb_bl(rom, 0x300, 0x800); // data
+	put_thumb_bl(rom, 0x11E, 0x800); // crossing the end of the function
+	put_arm_branch(rom, 0x108, 0x800, true); // ARM looking word in thumb code
+	put_thumb_bl(rom, 0x200, 0x800); // thumb looking halfwords in ARM code
+
+	branch_index index;
+	index.build(rom, { { 0x100, 0x120, true }, { 0x200, 0x210, false } }, {});
+
+	CHECK(index.size() == 0);
+}
+
+TEST_CASE(excluded_branches_are_left_out) {
+	std::vector<std::uint8_t> rom(0x1000);
+
+	put_thumb_bl(rom, 0x100, 0x800);
+	put_thumb_bl(rom, 0x108, 0x800);
+	put_thumb_bl(rom, 0x110, 0x800);
+
+	branch_index index;
+	index.build(rom, { { 0x100, 0x120, true } }, { { 0x10A, 0x10C }, { 0x112, 0x114 }, { 0x000, 0x100 } });
+
+	CHECK(offsets_of(index, 0x800) == std::vector<unsigned>({ 0x100 }));
+}
+
+TEST_CASE(overlapping_functions_are_scanned_once) {
+	std::vector<std::uint8_t> rom(0x1000);
+
+	put_thumb_bl(rom, 0x110, 0x800);
+
+	branch_index index;
+	index.build(rom, { { 0x100, 0x120, true }, { 0x108, 0x118, true }, { 0x100, 0x120, true }, { 0xFF0, 0x2000, true } }, {});
+
+	CHECK(offsets_of(index, 0x800) == std::vector<unsigned>({ 0x110 }));
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
@@ -0,0 +1,101 @@
+#include "tests/test.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/free_space.h"
+#include "core/mapped_file.h"
+
+using lyn::free_run;
+
+namespace {
+
+using run_list = std::vector<std::pair<unsigned, unsigned>>;
+
+run_list runs_of(const std::vector<free_run>& runs) {
+	run_list result;
+
+	for (auto& run : runs)
+		result.emplace_back(run.offset, run.size);
+
+	return result;
+}
+
+// code with a run of each filler, one too short and one that only fits once aligned
+
+std::vector<std::uint8_t> make_rom() {
+	std::vector<std::uint8_t> rom(0x1000, 0x5A);
+
+	std::fill(rom.begin() + 0x100, rom.begin() + 0x200, 0x00);
+	std::fill(rom.begin() + 0x400, rom.begin() + 0x410, 0xFF);
+	std::fill(rom.begin() + 0x801, rom.begin() + 0x841, 0xFF);
+	std::fill(rom.begin() + 0xF00, rom.end(), 0xFF);
+
+	return rom;
+}
+
+const run_list EXPECTED_RUNS { { 0x100, 0x100 }, { 0x804, 0x3D }, { 0xF00, 0x100 } };
+
+std::vector<std::string> files_in(const std::filesystem::path& directory) {
+	std::vector<std::string> result;
+	std::error_code error;
+
+	for (auto it = std::filesystem::directory_iterator(directory, error); !error && it != std::filesystem::directory_iterator(); it.increment(error))
+		result.push_back(it->path().string());
+
+	return result;
+}
+
+} // namespace
+
+TEST_CASE(runs_of_filler) {
+	auto rom = make_rom();
+
+	CHECK(runs_of(lyn::find_free_space(rom, 0x20, 4)) == EXPECTED_RUNS);
+	CHECK(runs_of(lyn::find_free_space(rom, 0x100, 4)) == run_list({ { 0x100, 0x100 }, { 0xF00, 0x100 } }));
+	CHECK(lyn::find_free_space({}, 0x20, 4).empty());
+}
+
+TEST_CASE(cached_runs) {
+	lyn::test::temporary_directory directory;
+	const std::filesystem::path cacheDirectory = directory.file("cache");
+
+	{
+		std::ofstream(directory.file("rom.gba"), std::ios::binary).write(reinterpret_cast<const char*>(make_rom().data()), 0x1000);
+	}
+
+	const lyn::mapped_file rom(directory.file("rom.gba"));
+
+	CHECK(runs_of(lyn::find_free_space_cached(rom, 0x20, 4, cacheDirectory, 1 << 20)) == EXPECTED_RUNS);
+
+	auto cached = files_in(directory.file("cache/free"));
+	CHECK(cached.size() == 1);
+
+	if (cached.size() != 1)
+		return;
+
+	// what's cached is what is used
+
+	std::ofstream(cached[0], std::ios::binary) << "200 40\nend 1\n";
+	CHECK(runs_of(lyn::find_free_space_cached(rom, 0x20, 4, cacheDirectory, 1 << 20)) == run_list({ { 0x200, 0x40 } }));
+
+	// unless it isn't complete (or is damaged), then the ROM is scanned again
+
+	for (auto text : { "200 40\n", "200 40\nend 2\n", "200 40\nend 1\n300 40\n", "200\nend 1\n", "200 4x\nend 1\n", "" }) {
+		std::ofstream(cached[0], std::ios::binary) << text;
+		CHECK(runs_of(lyn::find_free_space_cached(rom, 0x20, 4, cacheDirectory, 1 << 20)) == EXPECTED_RUNS);
+	}
+
+	// other options are cached on their own
+
+	CHECK(lyn::find_free_space_cached(rom, 0x100, 4, cacheDirectory, 1 << 20).size() == 2);
+	CHECK(files_in(directory.file("cache/free")).size() == 2);
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
@@ -0,0 +1,264 @@
+#include "tests/test.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/jobserver.h"
+
+using lyn::jobserver;
+
+namespace {
+
+// a jobserver pipe as make would give it, holding some tokens
+
+class token_pipe {
+public:
+	explicit token_pipe(const std::string& tokens) {
+		if (::pipe(mFds) != 0)
+			throw std::runtime_error("couldn't make a pipe");
+
+		write_tokens(mFds[1], tokens);
+	}
+
+	~token_pipe() {
+		::close(mFds[0]);
+		::close(mFds[1]);
+	}
+
+	token_pipe(const token_pipe&) = delete;
+	token_pipe& operator = (const token_pipe&) = delete;
+
+	std::string fds() const { return std::format("{0},{1}", mFds[0], mFds[1]); }
+
+	/* the tokens in the pipe (which are then taken out of it) */
+	std::string take_tokens() const { return read_tokens(mFds[0]); }
+
+	static void write_tokens(int fd, const std::string& tokens) {
+		if (!tokens.empty() && ::write(fd, tokens.data(), tokens.size()) != static_cast<ssize_t>(tokens.size()))
+			throw std::runtime_error("couldn't write tokens");
+	}
+
+	static std::string read_tokens(int fd) {
+		const int flags = ::fcntl(fd, F_GETFL);
+		::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+		std::string result;
+		char buffer[64];
+
+		for (ssize_t size; (size = ::read(fd, buffer, sizeof(buffer))) > 0; )
+			result.append(buffer, size);
+
+		::fcntl(fd, F_SETFL, flags);
+
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+private:
+	int mFds[2];
+};
+
+// descriptors that aren't open (those of a pipe that was closed)
+
+std::string closed_fds() {
+	int fds[2];
+
+	if (::pipe(fds) != 0)
+		throw std::runtime_error("couldn't make a pipe");
+
+	::close(fds[0]);
+	::close(fds[1]);
+
+	return std::format("{0},{1}", fds[0], fds[1]);
+}
+
+unsigned acquire_all(jobserver& tokens) {
+	unsigned count = 0;
+
+	while (tokens.try_acquire())
+		count++;
+
+	return count;
+}
+
+} // namespace
+
+TEST_CASE(no_jobserver) {
+	token_pipe pipe("ab");
+
+	CHECK(!jobserver::from_make_flags(""));
+	CHECK(!jobserver::from_make_flags("k -j4 --no-print-directory"));
+	CHECK(!jobserver::from_make_flags("-j --jobserver-style=pipe"));
+
+	// what comes after `--` are variables
+
+	CHECK(!jobserver::from_make_flags("k -- --jobserver-auth=" + pipe.fds()));
+	CHECK(!jobserver::from_make_flags("-- X=--jobserver-auth=" + pipe.fds()));
+}
+
+TEST_CASE(pipe_tokens_are_taken_and_given_back) {
+	token_pipe pipe("abc");
+
+	auto tokens = jobserver::from_make_flags("-j --jobserver-auth=" + pipe.fds() + " -- CFLAGS=-O2");
+
+	CHECK(tokens != nullptr);
+
+	if (!tokens)
+		return;
+
+	CHECK(acquire_all(*tokens) == 3);
+	CHECK(pipe.take_tokens().empty());
+
+	for (int i = 0; i < 3; ++i)
+		tokens->release();
+
+	// (the same characters, as make may tell tokens apart)
+
+	CHECK(pipe.take_tokens() == "abc");
+
+	// giving back more than was taken does nothing
+
+	tokens->release();
+	CHECK(pipe.take_tokens().empty());
+}
+
+TEST_CASE(tokens_held_are_given_back_on_destruction) {
+	token_pipe pipe("xy");
+
+	{
+		auto tokens = jobserver::from_make_flags("--jobserver-auth=" + pipe.fds());
+
+		CHECK(tokens && tokens->try_acquire());
+	}
+
+	CHECK(pipe.take_tokens() == "xy");
+}
+
+TEST_CASE(older_make_fds) {
+	token_pipe pipe("+");
+
+	auto tokens = jobserver::from_make_flags("-j --jobserver-fds=" + pipe.fds());
+
+	CHECK(tokens && acquire_all(*tokens) == 1);
+}
+
+TEST_CASE(last_one_wins) {
+	token_pipe pipe("ab");
+
+	auto tokens = jobserver::from_make_flags(std::format("--jobserver-auth={0} --jobserver-auth={1}", closed_fds(), pipe.fds()));
+	CHECK(tokens && acquire_all(*tokens) == 2);
+
+	tokens.reset();
+
+	tokens = jobserver::from_make_flags(std::format("--jobserver-fds={0} --jobserver-auth={1}", pipe.fds(), closed_fds()));
+	CHECK(tokens && acquire_all(*tokens) == 0);
+}
+
+TEST_CASE(fifo_tokens) {
+	lyn::test::temporary_directory directory;
+	const auto path = directory.file("jobserver");
+
+	CHECK(::mkfifo(path.c_str(), 0600) == 0);
+
+	// (held open for writing, as make does, so that the fifo can be read without waiting)
+
+	const int fd = ::open(path.c_str(), O_RDWR);
+	CHECK(fd >= 0);
+
+	if (fd < 0)
+		return;
+
+	token_pipe::write_tokens(fd, "ab");
+
+	{
+		auto tokens = jobserver::from_make_flags("-j --jobserver-auth=fifo:" + path);
+
+		CHECK(tokens != nullptr);
+
+		if (tokens) {
+			CHECK(acquire_all(*tokens) == 2);
+			tokens->release();
+		}
+	}
+
+	CHECK(token_pipe::read_tokens(fd) == "ab");
+
+	::close(fd);
+}
+
+TEST_CASE(shared_through_fifo_path) {
+	token_pipe pipe("abc");
+
+	auto tokens = jobserver::from_make_flags("--jobserver-auth=" + pipe.fds());
+
+	CHECK(tokens && !tokens->fifo_path().empty());
+
+	if (!tokens || tokens->fifo_path().empty())
+		return;
+
+	// (as lyn serve does with the jobserver of a client)
+
+	auto shared = jobserver::from_make_flags("--jobserver-auth=fifo:" + tokens->fifo_path());
+
+	CHECK(shared && shared->fifo_path() == tokens->fifo_path());
+
+	if (!shared)
+		return;
+
+	CHECK(tokens->try_acquire());
+	CHECK(acquire_all(*shared) == 2);
+
+	shared->release();
+	tokens->release();
+
+	CHECK(pipe.take_tokens().size() == 2);
+}
+
+TEST_CASE(unusable_jobservers_never_have_tokens) {
+	lyn::test::temporary_directory directory;
+
+	const auto fileName = directory.file("not_a_fifo");
+	std::ofstream(fileName) << "tokens";
+
+	const int fileFd = ::open(fileName.c_str(), O_RDWR);
+	CHECK(fileFd >= 0);
+
+	for (auto auth : {
+		closed_fds(),
+		std::format("{0},{0}", fileFd),
+		std::string("3"),
+		std::string("3,"),
+		std::string(",4"),
+		std::string("-1,-1"),
+		std::string("3x,4"),
+		std::string("99999999999,4"),
+		"fifo:" + fileName,
+		"fifo:" + directory.file("missing"),
+		std::string("fifo:"),
+		std::string(),
+	}) {
+		auto tokens = jobserver::from_make_flags("-j --jobserver-auth=" + auth);
+
+		// (make still said there was one, lyn then just doesn't use it)
+
+		CHECK(tokens != nullptr);
+
+		if (tokens) {
+			CHECK(!tokens->try_acquire());
+			CHECK(tokens->fifo_path().empty());
+			tokens->release();
+		}
+	}
+
+	::close(fileFd);
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
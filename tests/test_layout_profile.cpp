@@ -0,0 +1,88 @@
+#include "tests/test.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "core/layout_profile.h"
+
+using lyn::layout_profile;
+
+namespace {
+
+layout_profile load_profile(const lyn::test::temporary_directory& directory, std::string_view text) {
+	const std::string fileName = directory.file("profile.txt");
+
+	std::ofstream(fileName, std::ios::binary) << text;
+
+	layout_profile profile;
+	profile.load_from_file(fileName.c_str());
+
+	return profile;
+}
+
+// the message of the error the profile gives, empty if it gives none
+
+std::string error_of(std::string_view text) {
+	lyn::test::temporary_directory directory;
+
+	try {
+		load_profile(directory, text);
+	} catch (const std::runtime_error& error) {
+		return error.what();
+	}
+
+	return std::string();
+}
+
+} // namespace
+
+TEST_CASE(weights_from_calls) {
+	lyn::test::temporary_directory directory;
+
+	auto profile = load_profile(directory,
+		"# calls only\n"
+		"Hot 100\n"
+		"Warm, 0x10\n"
+		"Hot 5\n");
+
+	CHECK(profile.weight("Hot") == 105);
+	CHECK(profile.weight("Warm") == 16);
+	CHECK(profile.weight("Missing") == 0);
+}
+
+TEST_CASE(weights_from_cycles) {
+	lyn::test::temporary_directory directory;
+
+	auto profile = load_profile(directory,
+		"Hot 100 20\n"
+		"Often 1000 0\n"
+		"Sym.dot $10 $400\n");
+
+	// (an entry giving 0 cycles weighs nothing, rather than falling back to its calls)
+
+	CHECK(profile.weight("Hot") == 20);
+	CHECK(profile.weight("Often") == 0);
+	CHECK(profile.weight("Sym_dot") == 0x400);
+}
+
+TEST_CASE(mixed_units_rejected) {
+	auto error = error_of(
+		"; header\n"
+		"Hot 100 20\n"
+		"Cold 3\n");
+
+	CHECK(error.find("profile.txt:3:") != std::string::npos);
+	CHECK(error.find("line 2") != std::string::npos);
+
+	CHECK(error_of("Cold 3\nHot 100 20\n").find("profile.txt:2:") != std::string::npos);
+}
+
+TEST_CASE(malformed_lines) {
+	CHECK(error_of("Hot\n").find("profile.txt:1:") != std::string::npos);
+	CHECK(error_of("Hot 1 2 3\n").find("profile.txt:1:") != std::string::npos);
+	CHECK(error_of("Hot 1\nCold many\n").find("profile.txt:2:") != std::string::npos);
+}
+
+int main() { return lyn::test::run_tests(); }
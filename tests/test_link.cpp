@@ -0,0 +1,97 @@
+#include "tests/test.h"
+#include "tests/elf_builder.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/event_object.h"
+
+using lyn::event_object;
+
+using namespace lyn::test;
+
+namespace {
+
+constexpr std::uint16_t SHN_ABS = 0xFFF1;
+
+// a reference object giving Original as an absolute function at that address (with the thumb bit for thumb ones)
+
+std::vector<std::uint8_t> make_reference(std::uint32_t originalAddress) {
+	return make_elf({}, {
+		{ "Original", originalAddress, 0x40, 1, 2, SHN_ABS },
+	}, {});
+}
+
+// a function replacing Original, as thumb or ARM code
+
+std::vector<std::uint8_t> make_replacement(bool isThumb) {
+	return make_elf({
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, byte_range(0, 0x10) },
+	}, {
+		{ isThumb ? "$t" : "$a", 0, 0, 0, 0, 1 },
+		{ "Original", isThumb ? 1u : 0u, 0x10, 1, 2, 1 },
+	}, {});
+}
+
+// what links do with replacements before writing them (see main.cpp), gives the hook for Original if there is one
+
+std::vector<event_object::hook> hooks_of(const std::vector<std::uint8_t>& reference, const std::vector<std::uint8_t>& replacement) {
+	event_object object;
+
+	object.append_from_elf("reference.o", reference);
+	object.append_from_elf("replacement.o", replacement);
+
+	object.place_replacements();
+	object.try_relocate_relatives();
+	object.try_relocate_absolutes();
+	object.remove_unnecessary_symbols();
+	object.cleanup();
+
+	return object.get_hooks();
+}
+
+} // namespace
+
+TEST_CASE(replacements_in_the_same_instruction_set_are_placed) {
+	// thumb over thumb, ARM over ARM: calls to the original land in the replacement as they are, so there's no hook
+
+	CHECK(hooks_of(make_reference(0x08001001), make_replacement(true)).empty());
+	CHECK(hooks_of(make_reference(0x08001000), make_replacement(false)).empty());
+}
+
+TEST_CASE(replacements_in_another_instruction_set_keep_their_hook) {
+	// ARM over thumb (a BL to the original would run ARM code in thumb state), and the other way around
+
+	for (bool isOriginalThumb : { true, false }) {
+		auto hooks = hooks_of(make_reference(isOriginalThumb ? 0x08001001 : 0x08001000), make_replacement(!isOriginalThumb));
+
+		CHECK(hooks.size() == 1);
+
+		if (hooks.size() != 1)
+			continue;
+
+		CHECK(hooks[0].name == "Original");
+		CHECK((hooks[0].originalOffset & ~1) == 0x1000);
+
+		// (the replacement is streamed rather than placed over the original)
+
+		CHECK(!hooks[0].replacementOffset);
+	}
+}
+
+TEST_CASE(replacements_that_dont_fit_keep_their_hook) {
+	auto replacement = make_elf({
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, byte_range(0, 0x80) },
+	}, {
+		{ "$t", 0, 0, 0, 0, 1 },
+		{ "Original", 1, 0x80, 1, 2, 1 },
+	}, {});
+
+	CHECK(hooks_of(make_reference(0x08001001), replacement).size() == 1);
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
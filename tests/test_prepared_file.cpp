@@ -0,0 +1,235 @@
+#include "tests/test.h"
+#include "tests/elf_builder.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/data_chunk.h"
+#include "core/event_object.h"
+#include "core/mapped_file.h"
+#include "core/prepared_file.h"
+
+using lyn::event_object;
+using lyn::prepared_reader;
+using lyn::prepared_writer;
+
+using namespace lyn::test;
+
+namespace {
+
+// an object with code, data, locals and calls to symbols it doesn't define, and one that defines them
+
+std::vector<std::uint8_t> make_code_object() {
+	return make_elf({
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, byte_range(0, 0x40) },
+		{ ".rodata", SHT_PROGBITS, SHF_ALLOC, byte_range(0x80, 0xA0) },
+	}, {
+		{ "$t", 0, 0, 0, 0, 1 },
+		{ "", 0, 0, 0, 3, 2 },
+		{ "static_fn", 0x21, 8, 0, 2, 1 },
+		{ "$d", 0x30, 0, 0, 0, 1 },
+		{ "MyFunc", 0x1, 0x20, 1, 2, 1 },
+		{ "MyTable", 0, 0x20, 1, 1, 2 },
+		{ "OtherFunc", 0, 0, 1, 0, 0 },
+		{ "AbsFunc", 0, 0, 1, 0, 0 },
+	}, {
+		{ ".text", 0x10, 7, R_ARM_THM_CALL },
+		{ ".text", 0x14, 3, R_ARM_THM_CALL },
+		{ ".text", 0x18, 8, R_ARM_THM_CALL },
+		{ ".text", 0x30, 2, R_ARM_ABS32 },
+		{ ".rodata", 0x0, 5, R_ARM_ABS32 },
+		{ ".rodata", 0x4, 8, R_ARM_ABS32 },
+		{ ".rodata", 0x8, 6, R_ARM_ABS32 },
+	});
+}
+
+std::vector<std::uint8_t> make_other_object() {
+	return make_elf({
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, byte_range(0x10, 0x28) },
+	}, {
+		{ "$t", 0, 0, 0, 0, 1 },
+		{ "helper", 0x9, 4, 0, 2, 1 },
+		{ "OtherFunc", 0x1, 0x18, 1, 2, 1 },
+		{ "AbsFunc", 0x08001235, 0x40, 1, 2, 0xFFF1 },
+		{ "gData", 0x03000000, 4, 1, 1, 0xFFF1 },
+		{ "MyFunc", 0, 0, 1, 0, 0 },
+	}, {
+		{ ".text", 0x4, 2, R_ARM_THM_CALL },
+		{ ".text", 0x10, 5, R_ARM_ABS32 },
+	});
+}
+
+// what the objects are written as, both as they are loaded and once linked
+
+std::string events_of(const event_object& object) {
+	std::ostringstream output;
+	object.write_events(output);
+
+	return std::move(output).str();
+}
+
+std::string linked_events_of(event_object& object) {
+	object.try_relocate_relatives();
+	object.try_relocate_absolutes();
+	object.remove_unnecessary_symbols();
+	object.cleanup();
+
+	return events_of(object);
+}
+
+void prepare(const std::vector<std::uint8_t>& elf, const std::string& fileName) {
+	event_object object;
+	object.append_from_elf("object.o", elf);
+
+	object.write_prepared(fileName);
+}
+
+std::vector<std::uint8_t> read_bytes(const std::string& fileName) {
+	const lyn::mapped_file file(fileName);
+	return std::vector<std::uint8_t>(file.data(), file.data() + file.size());
+}
+
+} // namespace
+
+TEST_CASE(words_and_arrays) {
+	const std::vector<std::uint16_t> halves { 1, 0xFFFF, 0x1234 };
+	const std::vector<std::uint64_t> longs { 0x0123456789ABCDEF, 0 };
+
+	prepared_writer writer;
+
+	writer.put_word(3);
+	writer.put_array(std::span(halves));
+	writer.put_word(5);
+	writer.put_chars("hello");
+	writer.put_array(std::span<const std::uint32_t>());
+	writer.put_array(std::span(longs));
+
+	prepared_reader reader("test.lyo", writer.bytes());
+
+	std::vector<std::uint16_t> readHalves;
+	std::vector<std::uint32_t> readEmpty;
+	std::vector<std::uint64_t> readLongs;
+
+	CHECK(reader.word() == 3);
+	reader.array<std::uint16_t>(readHalves, 3);
+	CHECK(reader.word() == 5);
+	CHECK(reader.chars(5) == "hello");
+	reader.array<std::uint32_t>(readEmpty, 0);
+	reader.array<std::uint64_t>(readLongs, 2);
+
+	CHECK(readHalves == halves);
+	CHECK(readEmpty.empty());
+	CHECK(readLongs == longs);
+	CHECK(reader.at_end());
+
+	// (arrays are aligned within the file, so that they can be copied as they are)
+
+	CHECK(writer.bytes().size() % 8 == 0);
+}
+
+TEST_CASE(rejects_other_files_and_versions) {
+	prepared_writer writer;
+	writer.put_word(1);
+
+	auto bytes = std::vector<std::uint8_t>(writer.bytes().begin(), writer.bytes().end());
+
+	CHECK_THROWS(prepared_reader("test.lyo", {}));
+	CHECK_THROWS(prepared_reader("test.lyo", std::span(bytes).first(8)));
+
+	auto other = bytes;
+	other[0] = 'X';
+	CHECK_THROWS(prepared_reader("test.lyo", other));
+
+	auto version = bytes;
+	lyn::store_le<std::uint32_t>(version.data() + 8, 99);
+	CHECK_THROWS(prepared_reader("test.lyo", version));
+
+	prepared_reader reader("test.lyo", bytes);
+
+	std::vector<std::uint32_t> values;
+
+	CHECK(reader.word() == 1);
+	CHECK_THROWS(reader.word());
+	CHECK_THROWS(reader.chars(1));
+	CHECK_THROWS(reader.array<std::uint32_t>(values, 1));
+	CHECK_THROWS(reader.array<std::uint32_t>(values, 0x40000000));
+}
+
+TEST_CASE(objects_link_the_same_prepared) {
+	lyn::test::temporary_directory directory;
+
+	const auto code = make_code_object();
+	const auto other = make_other_object();
+
+	prepare(code, directory.file("code.lyo"));
+	prepare(other, directory.file("other.lyo"));
+
+	CHECK(prepared_reader::is_prepared_file(directory.file("code.lyo")));
+
+	// every mix of objects and prepared objects gives the same, as loaded and once linked
+	// (the second object exercises moving the keys of locals after those of the first)
+
+	event_object fromElves;
+	fromElves.append_from_elf("code.o", code);
+	fromElves.append_from_elf("other.o", other);
+
+	const auto expected = events_of(fromElves);
+	const auto expectedLinked = linked_events_of(fromElves);
+
+	CHECK(!expected.empty());
+	CHECK(expected != expectedLinked);
+
+	for (unsigned mix = 1; mix < 4; ++mix) {
+		event_object object;
+
+		if (mix & 1)
+			object.append_from_prepared(directory.file("code.lyo").c_str());
+		else
+			object.append_from_elf("code.o", code);
+
+		if (mix & 2)
+			object.append_from_prepared(directory.file("other.lyo").c_str());
+		else
+			object.append_from_elf("other.o", other);
+
+		CHECK(object.absolute_symbols().size() == 2);
+		CHECK(events_of(object) == expected);
+		CHECK(linked_events_of(object) == expectedLinked);
+	}
+}
+
+TEST_CASE(damaged_objects_never_read_out_of_the_file) {
+	lyn::test::temporary_directory directory;
+
+	prepare(make_code_object(), directory.file("code.lyo"));
+
+	const auto good = read_bytes(directory.file("code.lyo"));
+
+	// truncated at every length, and with every word made huge in turn
+	// (loading then either throws or gives some object, out of bounds reads are for the sanitizers to find)
+
+	auto tryLoad = [] (std::span<const std::uint8_t> bytes) {
+		try {
+			event_object object;
+			object.append_from_prepared("code.lyo", bytes);
+			events_of(object);
+		} catch (const std::exception&) {
+		}
+	};
+
+	for (std::size_t size = 0; size < good.size(); ++size)
+		tryLoad(std::span(good).first(size));
+
+	for (std::size_t offset = 12; offset + 4 <= good.size(); offset += 4) {
+		auto bytes = good;
+		lyn::store_le<std::uint32_t>(bytes.data() + offset, 0xFFFFFFF0);
+
+		tryLoad(bytes);
+	}
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
@@ -0,0 +1,265 @@
+#include "tests/test.h"
+#include "tests/elf_builder.h"
+
+#include <cstdint>
+#include <format>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/event_object.h"
+
+using lyn::event_object;
+
+using namespace lyn::test;
+
+namespace {
+
+constexpr std::uint16_t SHN_ABS = 0xFFF1;
+
+// code with one of each supported relocation to Target
+// (data relocations have their addend in place, branches have the usual ones for a branch to itself)
+
+std::vector<std::uint8_t> make_caller() {
+	std::string code;
+
+	put32(code, 4);          // 0x00 R_ARM_ABS32
+	put32(code, 0x10);       // 0x04 R_ARM_REL32
+	put16(code, 2);          // 0x08 R_ARM_ABS16
+	code += '\x01';          // 0x0A R_ARM_ABS8
+	code += '\0';
+	put16(code, 0xF000);     // 0x0C R_ARM_THM_CALL
+	put16(code, 0xF800);
+	put32(code, 0xEBFFFFFE); // 0x10 R_ARM_CALL
+	put32(code, 0xEAFFFFFE); // 0x14 R_ARM_JUMP24
+	put16(code, 0xE7FE);     // 0x18 R_ARM_THM_JUMP11
+	put16(code, 0xD0FE);     // 0x1A R_ARM_THM_JUMP8
+	put32(code, 0xE12FFF10); // 0x1C R_ARM_V4BX (bx r0)
+
+	return make_elf({
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, code },
+	}, {
+		{ "Target", 0, 0, 1, 0, 0 },
+		{ "Caller", 0, 0x20, 1, 2, 1 },
+	}, {
+		{ ".text", 0x00, 1, R_ARM_ABS32 },
+		{ ".text", 0x04, 1, R_ARM_REL32 },
+		{ ".text", 0x08, 1, R_ARM_ABS16 },
+		{ ".text", 0x0A, 1, R_ARM_ABS8 },
+		{ ".text", 0x0C, 1, R_ARM_THM_CALL },
+		{ ".text", 0x10, 1, R_ARM_CALL },
+		{ ".text", 0x14, 1, R_ARM_JUMP24 },
+		{ ".text", 0x18, 1, R_ARM_THM_JUMP11 },
+		{ ".text", 0x1A, 1, R_ARM_THM_JUMP8 },
+		{ ".text", 0x1C, 1, R_ARM_V4BX },
+	});
+}
+
+// Target as a thumb function of the objects, which calls back into Caller
+
+std::vector<std::uint8_t> make_target() {
+	std::string code;
+
+	put16(code, 0xF000);
+	put16(code, 0xF800);
+	code += byte_range(0, 0x0C);
+
+	return make_elf({
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, code },
+	}, {
+		{ "$t", 0, 0, 0, 0, 1 },
+		{ "Target", 1, 0x10, 1, 2, 1 },
+		{ "Caller", 0, 0, 1, 0, 0 },
+	}, {
+		{ ".text", 0, 3, R_ARM_THM_CALL },
+	});
+}
+
+// a reference object giving Target as an absolute thumb function
+
+std::vector<std::uint8_t> make_reference() {
+	return make_elf({}, {
+		{ "Target", 0x08004001, 0x40, 1, 2, SHN_ABS },
+	}, {});
+}
+
+// links the objects as main.cpp does (without a base ROM or regions), gives the events it writes
+
+std::string link_events(const std::vector<std::vector<std::uint8_t>>& objects) {
+	event_object object;
+
+	for (std::size_t i = 0; i < objects.size(); ++i)
+		object.append_from_elf(std::format("object{0}.o", i).c_str(), objects[i]);
+
+	object.place_replacements();
+	object.try_relocate_relatives();
+	object.try_relocate_absolutes();
+	object.remove_unnecessary_symbols();
+	object.cleanup();
+
+	std::ostringstream output;
+
+	for (auto& hook : object.get_hooks())
+		output << "hook " << hook.name << std::endl;
+
+	object.write_events(output);
+	return std::move(output).str();
+}
+
+// a section of words 0 to 3 with these relocations (to Target), written as loaded (so without sorting them first)
+
+std::string write_as_loaded(const std::vector<elf_relocation>& relocations) {
+	std::string words;
+
+	for (std::uint32_t i = 0; i < 4; ++i)
+		put32(words, i);
+
+	event_object object;
+
+	object.append_from_elf("section.o", make_elf({
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, words },
+	}, {
+		{ "Target", 0, 0, 1, 0, 0 },
+	}, relocations));
+
+	std::ostringstream output;
+	object.write_events(output);
+
+	return std::move(output).str();
+}
+
+} // namespace
+
+// what lyn writes for each relocation type, to a target that isn't linked and to an absolute one
+// (this is what lyn wrote before relocations were table driven, see lyn::arm_relocator, except for the PC-relative word
+// to an absolute address, which was resolved as if the section was at address 0)
+
+TEST_CASE(unresolved_targets) {
+	CHECK(link_events({ make_caller() }) ==
+		"ALIGN 4\n"
+		"PUSH\n"
+		"ORG CURRENTOFFSET+$0;Caller:\n"
+		"POP\n"
+		"POIN Target+4\n"
+		"WORD Target+16-CURRENTOFFSET\n"
+		"SHORT Target+2\n"
+		"BYTE Target+1\n"
+		"BYTE $0\n"
+		"SHORT ((Target-4-CURRENTOFFSET>>12)&$7FF)|$F000 ((Target-4-CURRENTOFFSET>>1)&$7FF)|$F800\n"
+		"WORD ((Target-8-CURRENTOFFSET>>2)&$FFFFFF)|$EB000000\n"
+		"WORD ((Target-8-CURRENTOFFSET>>2)&$FFFFFF)|$EA000000\n"
+		"SHORT ((Target-4-CURRENTOFFSET>>1)&$7FF)|$E000\n"
+		"SHORT ((Target-4-CURRENTOFFSET>>1)&$FF)|$D000\n"
+		"WORD $E12FFF10\n");
+}
+
+TEST_CASE(absolute_targets) {
+	// (a PC-relative word depends on where it ends up, even to an absolute address, so it's left to EA)
+
+	CHECK(link_events({ make_caller(), make_reference() }) ==
+		"ALIGN 4\n"
+		"PUSH\n"
+		"ORG CURRENTOFFSET+$0;Caller:\n"
+		"POP\n"
+		"WORD $8004005\n"
+		"WORD $8004001+16-CURRENTOFFSET\n"
+		"WORD $24003\n"
+		"SHORT (($8004001-4-CURRENTOFFSET>>12)&$7FF)|$F000 (($8004001-4-CURRENTOFFSET>>1)&$7FF)|$F800\n"
+		"WORD (($8004001-8-CURRENTOFFSET>>2)&$FFFFFF)|$EB000000\n"
+		"WORD (($8004001-8-CURRENTOFFSET>>2)&$FFFFFF)|$EA000000\n"
+		"SHORT (($8004001-4-CURRENTOFFSET>>1)&$7FF)|$E000\n"
+		"SHORT (($8004001-4-CURRENTOFFSET>>1)&$FF)|$D000\n"
+		"WORD $E12FFF10\n");
+}
+
+// the same to a target linked with it, streamed right after the caller or placed over the reference function
+// (this is what lyn wrote before relocations were stored as parallel arrays, see lyn::section_data, without the bytes
+// that R_ARM_V4BX repeated)
+
+TEST_CASE(streamed_targets) {
+	// (relative relocations are resolved, absolute ones are made relative to where they are written)
+
+	CHECK(link_events({ make_caller(), make_target() }) ==
+		"ALIGN 4\n"
+		"PUSH\n"
+		"ORG CURRENTOFFSET+$0;Caller:\n"
+		"POP\n"
+		"POIN CURRENTOFFSET+37\n"
+		"WORD $2D\n"
+		"SHORT CURRENTOFFSET+27\n"
+		"BYTE CURRENTOFFSET+24\n"
+		"BYTE $0\n"
+		"WORD $F808F000 $EB000002 $EA000001 $D001E002\n"
+		"WORD $E12FFF10\n"
+		"ALIGN 4\n"
+		"PUSH\n"
+		"ORG CURRENTOFFSET+$1;Target:\n"
+		"POP\n"
+		"WORD $FFEEF7FF $3020100 $7060504 $B0A0908\n");
+}
+
+TEST_CASE(placed_targets) {
+	// (the streamed caller refers to the placed target by address, and the placed target to the caller by name)
+
+	CHECK(link_events({ make_caller(), make_target(), make_reference() }) ==
+		"ALIGN 4\n"
+		"PUSH\n"
+		"ORG CURRENTOFFSET+$0;Caller:\n"
+		"POP\n"
+		"POIN $4001+4\n"
+		"WORD $4001+16-CURRENTOFFSET\n"
+		"SHORT $4001+2\n"
+		"BYTE $4001+1\n"
+		"BYTE $0\n"
+		"SHORT (($4001-4-CURRENTOFFSET>>12)&$7FF)|$F000 (($4001-4-CURRENTOFFSET>>1)&$7FF)|$F800\n"
+		"WORD (($4001-8-CURRENTOFFSET>>2)&$FFFFFF)|$EB000000\n"
+		"WORD (($4001-8-CURRENTOFFSET>>2)&$FFFFFF)|$EA000000\n"
+		"SHORT (($4001-4-CURRENTOFFSET>>1)&$7FF)|$E000\n"
+		"SHORT (($4001-4-CURRENTOFFSET>>1)&$FF)|$D000\n"
+		"WORD $E12FFF10\n"
+		"PUSH\n"
+		"ORG $4000\n"
+		"PUSH\n"
+		"ORG CURRENTOFFSET+$1;Target:\n"
+		"POP\n"
+		"SHORT ((Caller-4-CURRENTOFFSET>>12)&$7FF)|$F000 ((Caller-4-CURRENTOFFSET>>1)&$7FF)|$F800\n"
+		"WORD $3020100 $7060504 $B0A0908\n"
+		"POP\n");
+}
+
+TEST_CASE(unhandled_relocation_types) {
+	CHECK_THROWS(write_as_loaded({ { ".text", 0, 1, 42 } })); // R_ARM_TARGET2
+}
+
+TEST_CASE(overlapping_relocations) {
+	CHECK_THROWS(write_as_loaded({ { ".text", 0, 1, R_ARM_ABS32 }, { ".text", 2, 1, R_ARM_ABS32 } }));
+	CHECK_THROWS(write_as_loaded({ { ".text", 4, 1, R_ARM_ABS32 }, { ".text", 4, 1, R_ARM_ABS16 } }));
+}
+
+TEST_CASE(unsorted_relocations) {
+	// relocations are sorted by event_object::cleanup, writing them out of order is an error rather than wrong output
+
+	CHECK_THROWS(write_as_loaded({ { ".text", 8, 1, R_ARM_ABS32 }, { ".text", 0, 1, R_ARM_ABS32 } }));
+
+	CHECK(write_as_loaded({ { ".text", 0, 1, R_ARM_ABS32 }, { ".text", 8, 1, R_ARM_ABS32 } }) ==
+		"ALIGN 4\n"
+		"POIN Target\n"
+		"WORD $1\n"
+		"POIN Target+2\n"
+		"WORD $3\n");
+}
+
+TEST_CASE(bytes_before_v4bx_are_written_once) {
+	// (R_ARM_V4BX leaves the instruction as it is)
+
+	CHECK(write_as_loaded({ { ".text", 0, 1, R_ARM_ABS32 }, { ".text", 8, 1, R_ARM_V4BX } }) ==
+		"ALIGN 4\n"
+		"POIN Target\n"
+		"WORD $1\n"
+		"WORD $2 $3\n");
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
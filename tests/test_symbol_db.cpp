@@ -0,0 +1,227 @@
+#include "tests/test.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "core/data_chunk.h"
+#include "core/mapped_file.h"
+#include "core/symbol_db.h"
+
+using lyn::symbol_db;
+
+namespace {
+
+// entries keep views on names, which live here
+
+struct entry_list {
+	std::vector<std::string> names;
+	std::vector<symbol_db::entry> entries;
+
+	void add(std::string name, unsigned address, unsigned size, bool isFunction) {
+		names.push_back(std::move(name));
+		entries.push_back({ {}, address, size, isFunction });
+	}
+
+	std::vector<symbol_db::entry>& get() {
+		for (std::size_t i = 0; i < entries.size(); ++i)
+			entries[i].name = names[i];
+
+		return entries;
+	}
+};
+
+std::vector<std::uint8_t> read_bytes(const std::string& fileName) {
+	const lyn::mapped_file file(fileName);
+	return std::vector<std::uint8_t>(file.data(), file.data() + file.size());
+}
+
+void write_bytes(const std::string& fileName, const std::vector<std::uint8_t>& bytes) {
+	std::ofstream output(fileName, std::ios::binary);
+	output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+} // namespace
+
+TEST_CASE(round_trip) {
+	lyn::test::temporary_directory directory;
+	const auto fileName = directory.file("symbols.lsdb");
+
+	// enough names to need buckets of several keys, given in no particular address order
+
+	entry_list list;
+
+	for (unsigned i = 0; i < 5000; ++i)
+		list.add(std::format("Symbol_{0}", i), 0x08000000 + ((i * 7919) % 5000) * 4, i % 17, (i % 3) != 0);
+
+	symbol_db::write(fileName, list.get());
+
+	CHECK(symbol_db::is_symbol_db_file(fileName));
+
+	const symbol_db db(fileName);
+
+	CHECK(db.size() == 5000);
+
+	for (std::size_t i = 0; i < list.entries.size(); ++i) {
+		auto& expected = list.entries[i];
+		auto index = db.find(expected.name);
+
+		CHECK(index.has_value());
+
+		if (!index)
+			continue;
+
+		auto entry = db.at(*index);
+
+		CHECK(entry.name == expected.name);
+		CHECK(entry.address == expected.address);
+		CHECK(entry.size == expected.size);
+		CHECK(entry.isFunction == expected.isFunction);
+	}
+
+	for (std::size_t i = 1; i < db.size(); ++i)
+		CHECK(db.at(i - 1).address <= db.at(i).address);
+
+	CHECK(!db.find("Symbol_5000"));
+	CHECK(!db.find(""));
+	CHECK(!db.find("Symbol_1 "));
+}
+
+TEST_CASE(repeated_names_keep_the_first) {
+	lyn::test::temporary_directory directory;
+	const auto fileName = directory.file("symbols.lsdb");
+
+	entry_list list;
+
+	list.add("Repeated", 0x08000100, 4, true);
+	list.add("Other", 0x08000200, 8, false);
+	list.add("Repeated", 0x08000300, 12, false);
+
+	symbol_db::write(fileName, list.get());
+
+	const symbol_db db(fileName);
+
+	CHECK(db.size() == 2);
+
+	auto index = db.find("Repeated");
+	CHECK(index && db.at(*index).address == 0x08000100 && db.at(*index).isFunction);
+}
+
+TEST_CASE(empty_and_single) {
+	lyn::test::temporary_directory directory;
+
+	entry_list empty;
+	symbol_db::write(directory.file("empty.lsdb"), empty.get());
+
+	const symbol_db emptyDb(directory.file("empty.lsdb"));
+
+	CHECK(emptyDb.size() == 0);
+	CHECK(!emptyDb.find("Anything"));
+	CHECK_THROWS(emptyDb.at(0));
+
+	entry_list single;
+	single.add("Only", 0x08001234, 2, true);
+	symbol_db::write(directory.file("single.lsdb"), single.get());
+
+	const symbol_db singleDb(directory.file("single.lsdb"));
+
+	CHECK(singleDb.size() == 1);
+	CHECK(singleDb.find("Only") == std::optional<std::size_t>(0));
+	CHECK(!singleDb.find("Other"));
+}
+
+TEST_CASE(rejects_other_files) {
+	lyn::test::temporary_directory directory;
+
+	write_bytes(directory.file("text.txt"), { 'n', 'o', 't', ' ', 'a', ' ', 'd', 'b' });
+
+	CHECK(!symbol_db::is_symbol_db_file(directory.file("text.txt")));
+	CHECK_THROWS(symbol_db(directory.file("text.txt")));
+	CHECK_THROWS(symbol_db(directory.file("missing.lsdb")));
+}
+
+TEST_CASE(rejects_malformed_headers) {
+	lyn::test::temporary_directory directory;
+	const auto fileName = directory.file("symbols.lsdb");
+
+	entry_list list;
+
+	for (unsigned i = 0; i < 100; ++i)
+		list.add(std::format("Name{0}", i), 0x08000000 + i * 4, 4, true);
+
+	symbol_db::write(fileName, list.get());
+
+	const auto good = read_bytes(fileName);
+
+	// other version
+
+	auto bytes = good;
+	lyn::store_le<std::uint32_t>(bytes.data() + 8, 99);
+	write_bytes(fileName, bytes);
+
+	CHECK_THROWS(symbol_db(fileName));
+
+	// truncated, or with trailing bytes
+
+	bytes = good;
+	bytes.pop_back();
+	write_bytes(fileName, bytes);
+
+	CHECK_THROWS(symbol_db(fileName));
+
+	bytes = good;
+	bytes.push_back(0);
+	write_bytes(fileName, bytes);
+
+	CHECK_THROWS(symbol_db(fileName));
+
+	bytes.assign(good.begin(), good.begin() + 20);
+	write_bytes(fileName, bytes);
+
+	CHECK_THROWS(symbol_db(fileName));
+
+	// counts that don't match the size
+
+	bytes = good;
+	lyn::store_le<std::uint32_t>(bytes.data() + 12, 0xFFFFFFFF);
+	write_bytes(fileName, bytes);
+
+	CHECK_THROWS(symbol_db(fileName));
+}
+
+TEST_CASE(damaged_tables_never_read_out_of_the_file) {
+	lyn::test::temporary_directory directory;
+	const auto fileName = directory.file("symbols.lsdb");
+
+	entry_list list;
+
+	for (unsigned i = 0; i < 64; ++i)
+		list.add(std::format("Name{0}", i), 0x08000000 + i * 4, 4, true);
+
+	symbol_db::write(fileName, list.get());
+
+	const auto good = read_bytes(fileName);
+
+	// every byte past the header gets damaged in turn, lookups then either throw or give some entry of the file
+	// (out of bounds reads are for the sanitizers to find)
+
+	for (std::size_t offset = 28; offset < good.size(); ++offset) {
+		auto bytes = good;
+		bytes[offset] ^= 0xA5;
+		write_bytes(fileName, bytes);
+
+		try {
+			const symbol_db db(fileName);
+
+			for (auto& entry : list.get()) {
+				if (auto index = db.find(entry.name))
+					CHECK(*index < db.size());
+			}
+		} catch (const std::exception&) {
+		}
+	}
+}
+
+int main() {
+	return lyn::test::run_tests();
+}
@@ -0,0 +1,191 @@
+#include "tests/test.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/symbol_list.h"
+
+using lyn::parse_symbol_list;
+using lyn::symbol_list_entry;
+
+namespace {
+
+bool is_entry(const symbol_list_entry& entry, std::string_view name, unsigned address, unsigned size, bool isFunction) {
+	return entry.name == name && entry.address == address && entry.size == size && entry.isFunction == isFunction;
+}
+
+// the message of the error the list gives, empty if it gives none
+
+std::string error_of(std::string_view text) {
+	try {
+		parse_symbol_list("list.txt", text);
+	} catch (const std::runtime_error& error) {
+		return error.what();
+	}
+
+	return std::string();
+}
+
+} // namespace
+
+TEST_CASE(assignments) {
+	auto entries = parse_symbol_list("list.txt",
+		"MyFunc = 0x08001235\n"
+		"MyData = $08002000 16 data;\n"
+		"  Other=134225920\n"
+		"Typed = 0x08003000 func 8\n");
+
+	CHECK(entries.size() == 4);
+
+	if (entries.size() != 4)
+		return;
+
+	CHECK(is_entry(entries[0], "MyFunc", 0x08001235, 0, true));
+	CHECK(is_entry(entries[1], "MyData", 0x08002000, 16, false));
+	CHECK(is_entry(entries[2], "Other", 0x08002000, 0, false));
+	CHECK(is_entry(entries[3], "Typed", 0x08003000, 8, true));
+}
+
+TEST_CASE(defines) {
+	auto entries = parse_symbol_list("list.event",
+		"#define MyFunc 0x08001235\n"
+		"\t#define MyData 0x08002000 4 object\n"
+		"#ifdef SOMETHING\n"
+		"#defineNotOne 0x08003000\n"
+		"#endif\n");
+
+	CHECK(entries.size() == 2);
+
+	if (entries.size() != 2)
+		return;
+
+	CHECK(is_entry(entries[0], "MyFunc", 0x08001235, 0, true));
+	CHECK(is_entry(entries[1], "MyData", 0x08002000, 4, false));
+}
+
+TEST_CASE(sym_addresses_are_hex) {
+	auto entries = parse_symbol_list("rom.sym",
+		"08001235 MyFunc\n"
+		"02000000 SomeRam 10\n");
+
+	CHECK(entries.size() == 2);
+
+	if (entries.size() != 2)
+		return;
+
+	CHECK(is_entry(entries[0], "MyFunc", 0x08001235, 0, true));
+	CHECK(is_entry(entries[1], "SomeRam", 0x02000000, 10, false));
+}
+
+TEST_CASE(sym_modes_and_data_blocks) {
+	// no$gba gives no thumb bits, the directives say what the symbols are (and a symbol may come before the directive at its address)
+
+	auto entries = parse_symbol_list("rom.sym",
+		"02000000 BeforeAnyCode\n"
+		"08000000 .arm\n"
+		"08000000 ArmEntry\n"
+		"080000C0 ThumbFunc\n"
+		"080000C0 .thumb\n"
+		"08000100 .wrd:0008\n"
+		"08000100 LiteralPool\n"
+		"08000104 InPool\n"
+		"08000108 AfterPool\n"
+		"08000200 .byt:0010\n"
+		"08000200 Table\n"
+		"08000300 .ARM\n"
+		"08000300 ArmFunc\n"
+		"08000304 Typed 4 data\n"
+		"08000400 .thumb\n"
+		"08000400 Explicit 0 func\n");
+
+	CHECK(entries.size() == 10);
+
+	if (entries.size() != 10)
+		return;
+
+	CHECK(is_entry(entries[0], "BeforeAnyCode", 0x02000000, 0, false));
+	CHECK(is_entry(entries[1], "ArmEntry", 0x08000000, 0, true));
+	CHECK(is_entry(entries[2], "ThumbFunc", 0x080000C1, 0, true));
+	CHECK(is_entry(entries[3], "LiteralPool", 0x08000100, 0, false));
+	CHECK(is_entry(entries[4], "InPool", 0x08000104, 0, false));
+	CHECK(is_entry(entries[5], "AfterPool", 0x08000109, 0, true));
+	CHECK(is_entry(entries[6], "Table", 0x08000200, 0, false));
+	CHECK(is_entry(entries[7], "ArmFunc", 0x08000300, 0, true));
+
+	// an explicit type wins over the directives (and keeps the address as given)
+
+	CHECK(is_entry(entries[8], "Typed", 0x08000304, 4, false));
+	CHECK(is_entry(entries[9], "Explicit", 0x08000400, 0, true));
+}
+
+TEST_CASE(csv) {
+	auto entries = parse_symbol_list("list.csv",
+		"name,address,size,type\n"
+		"MyFunc,0x08001235\n"
+		"0x08002000,MyData,4,data\n"
+		"\"Quoted\",0x08003000,,func\n");
+
+	CHECK(entries.size() == 3);
+
+	if (entries.size() != 3)
+		return;
+
+	CHECK(is_entry(entries[0], "MyFunc", 0x08001235, 0, true));
+	CHECK(is_entry(entries[1], "MyData", 0x08002000, 4, false));
+	CHECK(is_entry(entries[2], "Quoted", 0x08003000, 0, true));
+}
+
+TEST_CASE(comments_and_blank_lines) {
+	auto entries = parse_symbol_list("list.txt",
+		"# comment\n"
+		"; comment\n"
+		"// comment\n"
+		"\n"
+		"   \t\r\n"
+		"MyFunc = 0x08001235 // trailing\n"
+		"Path/Like = 0x08002000 ; trailing\n"
+		"08003000 SymName # trailing\r\n");
+
+	CHECK(entries.size() == 3);
+
+	if (entries.size() != 3)
+		return;
+
+	CHECK(is_entry(entries[0], "MyFunc", 0x08001235, 0, true));
+	CHECK(is_entry(entries[1], "Path/Like", 0x08002000, 0, false));
+	CHECK(is_entry(entries[2], "SymName", 0x08003000, 0, false));
+
+	CHECK(parse_symbol_list("list.txt", "").empty());
+	CHECK(parse_symbol_list("list.txt", "\n\n# only comments\n").empty());
+}
+
+TEST_CASE(malformed_lines_give_their_number) {
+	CHECK(error_of("A = 0x08000000\nB = nowhere\n").starts_with("list.txt:2:"));
+	CHECK(error_of("A = 0x08000000\n\nB = 0x08000000 4 4\n").starts_with("list.txt:3:"));
+	CHECK(error_of("just_a_name\n").starts_with("list.txt:1:"));
+	CHECK(error_of("#define A\n").starts_with("list.txt:1:"));
+	CHECK(error_of("A = 0x100000000\n").starts_with("list.txt:1:"));
+	CHECK(error_of("A = 99999999999\n").starts_with("list.txt:1:"));
+	CHECK(error_of("A,B\n0x08000000,C\n").empty()); // (a header)
+	CHECK(error_of("0x08000000,C\nA,B\n").starts_with("list.txt:2:"));
+	CHECK(error_of("A = = 0x08000000\n").starts_with("list.txt:1:"));
+	CHECK(error_of("A = 0x08000000 1 2 3 4 5 6 7 8 9 10 11 12\n").starts_with("list.txt:1:"));
+	CHECK(error_of("0800000G Name\n").starts_with("list.txt:1:"));
+}
+
+TEST_CASE(symbol_list_files) {
+	CHECK(lyn::is_symbol_list_file("rom.sym"));
+	CHECK(lyn::is_symbol_list_file("dir/ROM.SYM"));
+	CHECK(lyn::is_symbol_list_file("list.csv"));
+	CHECK(lyn::is_symbol_list_file("list.txt"));
+	CHECK(lyn::is_symbol_list_file("defs.event"));
+	CHECK(!lyn::is_symbol_list_file("object.o"));
+	CHECK(!lyn::is_symbol_list_file("dir.sym/object"));
+	CHECK(!lyn::is_symbol_list_file("sym"));
+}
+
+int main() {
+	return lyn::test::run_tests();
+}